@@ -0,0 +1,131 @@
+#include "alloc_track.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+// Each block carries its size in a header, so unsized deletes can take it
+// off the live count. 16 bytes keeps the payload max_align_t aligned.
+// Aligned and nothrow forms are left to the library; nothing here uses
+// them.
+static const size_t HEADER = 16;
+
+static std::atomic<long long> totalAllocations{0}, totalBytes{0}, liveBytes{0}, peakLive{0};
+static thread_local AllocScope* openScope = nullptr;
+
+static void raise(std::atomic<long long>& peak, long long value) {
+    long long seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void* operator new(size_t size) {
+    char* block = (char*)std::malloc(size + HEADER);
+    if (!block) throw std::bad_alloc();
+    std::memcpy(block, &size, sizeof size);
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add((long long)size, std::memory_order_relaxed);
+    long long live = liveBytes.fetch_add((long long)size, std::memory_order_relaxed) + (long long)size;
+    raise(peakLive, live);
+    if (openScope) openScope->allocated((long long)size, live);
+    return block + HEADER;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+// GCC pairs the malloc above with these frees and warns, wrongly.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* block = (char*)p - HEADER;
+    size_t size;
+    std::memcpy(&size, block, sizeof size);
+    liveBytes.fetch_sub((long long)size, std::memory_order_relaxed);
+    std::free(block);
+}
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+#pragma GCC diagnostic pop
+
+static const int MAX_PHASES = 64;
+static AllocPhase phases[MAX_PHASES + 1];
+static std::atomic<int> registered{0};
+static std::mutex registering;
+
+AllocPhase& allocPhase(const char* name) {
+    std::lock_guard<std::mutex> lock(registering);
+    int n = registered.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; i++) {
+        if (!std::strcmp(phases[i].name, name)) return phases[i];
+    }
+    if (n == MAX_PHASES) {
+        phases[MAX_PHASES].name = "(other)";
+        return phases[MAX_PHASES];
+    }
+    phases[n].name = name;
+    registered.store(n + 1, std::memory_order_release);
+    return phases[n];
+}
+
+AllocScope::AllocScope(AllocPhase& phase)
+    : phase_(phase), parent_(openScope), entryLive_(liveBytes.load(std::memory_order_relaxed)) {
+    openScope = this;
+}
+
+AllocScope::~AllocScope() {
+    openScope = parent_;
+    phase_.calls.fetch_add(1, std::memory_order_relaxed);
+    phase_.allocations.fetch_add(allocations_, std::memory_order_relaxed);
+    phase_.bytes.fetch_add(bytes_, std::memory_order_relaxed);
+    raise(phase_.peakBytes, peak_);
+}
+
+// Passes the allocation on to the enclosing scopes, which are always
+// opened no later than this one and so are still open.
+void AllocScope::allocated(long long size, long long live) {
+    for (AllocScope* s = this; s; s = s->parent_) {
+        s->allocations_++;
+        s->bytes_ += size;
+        s->peak_ = std::max(s->peak_, live - s->entryLive_);
+    }
+}
+
+AllocTotals allocTotals() {
+    AllocTotals t;
+    t.allocations = totalAllocations.load(std::memory_order_relaxed);
+    t.bytes = totalBytes.load(std::memory_order_relaxed);
+    t.live = liveBytes.load(std::memory_order_relaxed);
+    t.peakLive = peakLive.load(std::memory_order_relaxed);
+    return t;
+}
+
+std::vector<AllocPhaseReport> allocReport() {
+    int n = registered.load(std::memory_order_acquire);
+    std::vector<AllocPhaseReport> report;
+    for (int i = 0; i <= MAX_PHASES; i++) {
+        if (i >= n && i < MAX_PHASES) continue;
+        const AllocPhase& p = phases[i];
+        long long calls = p.calls.load(std::memory_order_relaxed);
+        if (calls == 0) continue;
+        report.push_back({p.name, calls, p.allocations.load(std::memory_order_relaxed),
+                          p.bytes.load(std::memory_order_relaxed), p.peakBytes.load(std::memory_order_relaxed)});
+    }
+    return report;
+}
+
+void allocReset() {
+    int n = registered.load(std::memory_order_acquire);
+    for (int i = 0; i <= MAX_PHASES; i++) {
+        if (i >= n && i < MAX_PHASES) continue;
+        phases[i].calls = 0;
+        phases[i].allocations = 0;
+        phases[i].bytes = 0;
+        phases[i].peakBytes = 0;
+    }
+    totalAllocations = 0;
+    totalBytes = 0;
+    peakLive = liveBytes.load(std::memory_order_relaxed);
+}
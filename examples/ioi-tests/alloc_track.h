@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// Allocation tracking for the solvers in this directory and the world map
+// entry point (../../worldmap.cpp). alloc_track.cpp replaces the global
+// operator new/delete with counting ones; the solvers mark their entry
+// points and phases with ALLOC_PHASE, which records only with
+// -DALLOC_TRACK=1 and otherwise expands to nothing, so the task builds
+// neither need alloc_track.cpp nor pay for it:
+//
+//   g++ -std=c++20 -O2 -DALLOC_TRACK=1 -I. ioi_bench.cpp alloc_track.cpp festival.cpp ... -o ioi_bench
+//
+// ../world_map_bench.cpp links it as well, for allocTotals() alone.
+//
+// A phase is inclusive: it counts what its thread allocates while the
+// scope, or any scope nested in it, is open. Work handed to other threads
+// (festival's bucket sorts, the threaded count_triples, the map engine's
+// pools) is not attributed to the caller's phases, only to the totals. The
+// high-water mark is of process-wide live bytes above the level at scope
+// entry, so it does include those threads. Phase names are entry point,
+// then "/phase".
+#ifndef ALLOC_TRACK
+#define ALLOC_TRACK 0
+#endif
+
+struct AllocPhase {
+    const char* name = nullptr;
+    std::atomic<long long> calls{0};
+    std::atomic<long long> allocations{0};  // operator new calls
+    std::atomic<long long> bytes{0};        // bytes they requested
+    std::atomic<long long> peakBytes{0};    // largest high-water mark of any call
+};
+
+// The registered phase of that name, registered on first use. Up to 64
+// names; past that they share one "(other)" entry.
+AllocPhase& allocPhase(const char* name);
+
+// Records into `phase` from construction to destruction.
+class AllocScope {
+public:
+    explicit AllocScope(AllocPhase& phase);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+    // Called by the allocator for every scope open on the thread.
+    void allocated(long long size, long long live);
+
+private:
+    AllocPhase& phase_;
+    AllocScope* parent_;
+    long long entryLive_, allocations_ = 0, bytes_ = 0, peak_ = 0;
+};
+
+struct AllocTotals {
+    long long allocations = 0, bytes = 0;
+    long long live = 0, peakLive = 0;  // bytes allocated and not yet freed
+};
+
+struct AllocPhaseReport {
+    const char* name;
+    long long calls, allocations, bytes, peakBytes;
+};
+
+AllocTotals allocTotals();
+
+// Phases with at least one call, in registration order. Allocates.
+std::vector<AllocPhaseReport> allocReport();
+
+// Zeroes every phase and the totals; the peak restarts at the live bytes.
+// Only while no scope is open.
+void allocReset();
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+
+#if ALLOC_TRACK
+// Records the rest of the enclosing scope as phase `name`, a string literal.
+#define ALLOC_PHASE(name)                                                                    \
+    static AllocPhase& ALLOC_CONCAT(allocPhase_, __LINE__) = allocPhase(name);              \
+    AllocScope ALLOC_CONCAT(allocScope_, __LINE__)(ALLOC_CONCAT(allocPhase_, __LINE__))
+#else
+#define ALLOC_PHASE(name) ((void)0)
+#endif
@@ -1,6 +1,226 @@
 #include "festival.h"
+#include "alloc_track.h"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <thread>
 #include <vector>
 
+// Token counts saturate here. It is above the total price of every coupon
+// (N * max P = 2e14), so a capped count still affords whatever the exact one
+// would, and (cap - P) * 4 still fits in 64 bits.
+static const long long TOKEN_CAP = 1LL << 60;
+
+static long long after_purchase(long long tokens, int price, int type) {
+    return std::min(TOKEN_CAP, (tokens - price) * type);
+}
+
+// Exchange argument: buying multiplier coupon i right before j leaves at
+// least as many tokens as j before i iff P_i T_i / (T_i - 1) <= P_j T_j / (T_j - 1).
+// Cross-multiplied in 128 bits; ties go to the lower index.
+static bool buy_before(long long pi, int ti, int i, long long pj, int tj, int j) {
+    __int128 lhs = (__int128)pi * ti * (tj - 1), rhs = (__int128)pj * tj * (ti - 1);
+    return lhs != rhs ? lhs < rhs : i < j;
+}
+
+// Most multiplier coupons the DP phase can buy. Each of its purchases loses
+// tokens, and the losses at least double from one to the next: with X the
+// tokens before a purchase of key k_i > X, the next coupon has k_j >= k_i,
+// so P_j > X (T_j - 1) / T_j and X - X'' >= T_j (X - X'). Tokens start below
+// the largest key (< 2^31) there, so fewer than 32 purchases fit. The limit
+// leaves room for 40, nine over that bound, and keeps the bitset one word.
+static const int LOSING_LIMIT = 40;
+static_assert(LOSING_LIMIT < 64, "improved[] holds one word per coupon");
+
+// Coupons split by type, struct-of-arrays: bucket t (1..4) is
+// [begin[t], begin[t + 1]) of both arrays, in index order until sorted.
+struct CouponBuckets {
+    std::vector<int> price, index;
+    int begin[6] = {};
+
+    int size(int t) const { return begin[t + 1] - begin[t]; }
+    std::span<int> prices(int t) { return {price.data() + begin[t], (size_t)size(t)}; }
+    std::span<int> indices(int t) { return {index.data() + begin[t], (size_t)size(t)}; }
+    std::span<const int> prices(int t) const { return {price.data() + begin[t], (size_t)size(t)}; }
+    std::span<const int> indices(int t) const { return {index.data() + begin[t], (size_t)size(t)}; }
+};
+
+// One counting pass over T, one scatter pass.
+static CouponBuckets partition_coupons(const std::vector<int>& P, const std::vector<int>& T) {
+    ALLOC_PHASE("max_coupons/partition");
+    int N = (int)P.size();
+    CouponBuckets b;
+    b.price.resize(N);
+    b.index.resize(N);
+    int count[5] = {};
+    for (int i = 0; i < N; i++) count[T[i]]++;
+    b.begin[1] = 0;
+    for (int t = 1; t <= 4; t++) b.begin[t + 1] = b.begin[t] + count[t];
+    int next[5];
+    std::copy(b.begin, b.begin + 5, next);
+    for (int i = 0; i < N; i++) {
+        int at = next[T[i]]++;
+        b.price[at] = P[i];
+        b.index[at] = i;
+    }
+    return b;
+}
+
+// LSD radix sort by price, two stable 15-bit passes (prices < 2^30), so
+// equal prices stay in index order and the data ends where it started.
+static void radix_sort(std::span<int> price, std::span<int> index) {
+    const int BITS = 15, DIGITS = 1 << BITS;
+    size_t n = price.size();
+    std::vector<int> tmpPrice(n), tmpIndex(n), count(DIGITS);
+    int *srcP = price.data(), *srcI = index.data(), *dstP = tmpPrice.data(), *dstI = tmpIndex.data();
+    for (int shift = 0; shift < 2 * BITS; shift += BITS) {
+        std::fill(count.begin(), count.end(), 0);
+        for (size_t k = 0; k < n; k++) count[(srcP[k] >> shift) & (DIGITS - 1)]++;
+        for (int d = 0, sum = 0; d < DIGITS; d++) {
+            int c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for (size_t k = 0; k < n; k++) {
+            int at = count[(srcP[k] >> shift) & (DIGITS - 1)]++;
+            dstP[at] = srcP[k];
+            dstI[at] = srcI[k];
+        }
+        std::swap(srcP, dstP);
+        std::swap(srcI, dstI);
+    }
+}
+
+// Within one multiplier type the exchange key is increasing in the price, so
+// buy_before reduces to (price, index) order; sorted as packed 64-bit keys.
+static void comparator_sort(std::span<int> price, std::span<int> index) {
+    size_t n = price.size();
+    std::vector<uint64_t> key(n);
+    for (size_t k = 0; k < n; k++) key[k] = (uint64_t)price[k] << 32 | (uint32_t)index[k];
+    std::sort(key.begin(), key.end());
+    for (size_t k = 0; k < n; k++) {
+        price[k] = (int)(key[k] >> 32);
+        index[k] = (int)(uint32_t)key[k];
+    }
+}
+
+// Below this many coupons the buckets are sorted on the calling thread; a
+// T = 1 bucket this small is not worth the radix sort's digit table.
+static const int PARALLEL_SORT_MIN = 1 << 15;
+static const int RADIX_SORT_MIN = 1 << 12;
+
+// T = 1 is sorted on the calling thread, each non-empty multiplier bucket on
+// its own.
+static void sort_buckets(CouponBuckets& b) {
+    ALLOC_PHASE("max_coupons/sort");
+    auto sortBucket = [&b](int t) {
+        if (t == 1 && b.size(t) >= RADIX_SORT_MIN) radix_sort(b.prices(t), b.indices(t));
+        else comparator_sort(b.prices(t), b.indices(t));
+    };
+    if ((int)b.price.size() < PARALLEL_SORT_MIN) {
+        for (int t = 1; t <= 4; t++) sortBucket(t);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int t = 2; t <= 4; t++) {
+        if (b.size(t) > 0) workers.emplace_back(sortBucket, t);
+    }
+    sortBucket(1);
+    for (std::thread& w : workers) w.join();
+}
+
+// O(N + 40 N) on sorted buckets. The multiplier buckets are merged in
+// exchange order into the answer buffer, and the coupons are taken in that
+// order while each purchase leaves at least as many tokens as it costs.
+// After that every further one loses tokens, so the rest are a DP over
+// exchange order: best[k], the most tokens left after buying k of them,
+// rolled over the coupons with a one-word bitset per coupon recording which
+// counts it improved (1.6 MB at N = 200 000). Each count's tokens then buy
+// the T = 1 coupons cheapest first, as many as they cover (binary search
+// over the price prefix sums), and the best total is reconstructed from the
+// bitsets.
+static std::vector<int> solve(long long A, const CouponBuckets& b) {
+    ALLOC_PHASE("max_coupons/solve");
+    int multipliers = b.begin[5] - b.begin[2];
+    std::vector<int> order(multipliers);
+    std::vector<int> price(multipliers), type(multipliers);
+    std::span<const int> bucketPrice[5], bucketIndex[5];
+    int head[5] = {};
+    for (int t = 2; t <= 4; t++) bucketPrice[t] = b.prices(t), bucketIndex[t] = b.indices(t);
+    for (int out = 0; out < multipliers; out++) {
+        int t = 0;
+        for (int u = 2; u <= 4; u++) {
+            if (head[u] == (int)bucketPrice[u].size()) continue;
+            if (t == 0 || buy_before(bucketPrice[u][head[u]], u, bucketIndex[u][head[u]], bucketPrice[t][head[t]], t,
+                                     bucketIndex[t][head[t]]))
+                t = u;
+        }
+        order[out] = bucketIndex[t][head[t]];
+        price[out] = bucketPrice[t][head[t]++];
+        type[out] = t;
+    }
+
+    long long tokens = A;
+    int taken = 0;
+    while (taken < multipliers) {
+        if (tokens < price[taken]) break;
+        long long next = after_purchase(tokens, price[taken], type[taken]);
+        if (next < tokens) break;
+        tokens = next;
+        taken++;
+    }
+
+    // best[k]: most tokens after k purchases among order[taken, i), -1 if
+    // unreachable. improved[i - taken] bit k: coupon order[i] set best[k].
+    int losing = multipliers - taken;
+    long long best[LOSING_LIMIT + 1];
+    std::fill(best, best + LOSING_LIMIT + 1, -1LL);
+    best[0] = tokens;
+    int reach = 0;
+    std::vector<uint64_t> improved(losing, 0);
+    for (int i = taken; i < multipliers; i++) {
+        for (int k = std::min(reach, LOSING_LIMIT - 1); k >= 0; k--) {
+            if (best[k] < price[i]) continue;
+            long long next = after_purchase(best[k], price[i], type[i]);
+            if (next > best[k + 1]) {
+                best[k + 1] = next;
+                improved[i - taken] |= 1ULL << (k + 1);
+                reach = std::max(reach, k + 1);
+            }
+        }
+    }
+
+    std::span<const int> unitPrice = b.prices(1), unitIndex = b.indices(1);
+    std::vector<long long> prefix(unitPrice.size() + 1, 0);
+    for (size_t k = 0; k < unitPrice.size(); k++) prefix[k + 1] = prefix[k] + unitPrice[k];
+    auto affordable = [&](long long x) {
+        return (int)(std::upper_bound(prefix.begin(), prefix.end(), x) - prefix.begin()) - 1;
+    };
+    int count = 0, bought = affordable(tokens);
+    for (int k = 1; k <= reach; k++) {
+        int units = affordable(best[k]);
+        if (k + units > count + bought) count = k, bought = units;
+    }
+
+    // The coupon that last improved best[k] before position i bought the
+    // k-th; walk back from the chosen count. Picks are staged because
+    // writing them in place would clobber positions not yet walked.
+    int picks[LOSING_LIMIT];
+    for (int i = multipliers - 1, k = count; k > 0; i--) {
+        if ((improved[i - taken] >> k) & 1) picks[--k] = order[i];
+    }
+    int out = taken + count;
+    std::copy(picks, picks + count, order.begin() + taken);
+    order.resize(out + bought);
+    std::copy(unitIndex.begin(), unitIndex.begin() + bought, order.begin() + out);
+    return order;
+}
+
+// Pipeline: counting partition by type, parallel bucket sorts, then the
+// solver over the bucket spans.
 std::vector<int> max_coupons(int A, std::vector<int> P, std::vector<int> T) {
-    return {};
+    ALLOC_PHASE("max_coupons");
+    CouponBuckets buckets = partition_coupons(P, T);
+    sort_buckets(buckets);
+    return solve(A, buckets);
 }
@@ -0,0 +1,519 @@
+// Benchmark and grader harness for every problem in this directory.
+//
+//   g++ -std=c++20 -O2 -DALLOC_TRACK=1 -I. ioi_bench.cpp alloc_track.cpp festival.cpp souvenirs.cpp souvenirs_shop.cpp triples.cpp ../../worldmap.cpp ../world_map.cpp -o ioi_bench -lpthread
+//   ./ioi_bench [--problem=all] [--seed=1] [--quick] [--json] [--phases]
+//   ./ioi_bench --json > baseline.json; ...; ./ioi_bench --baseline=baseline.json
+//
+// Every solver is reached through its task header (festival.h, souvenirs.h,
+// triples.h, worldmap.h), the way the official grader calls it. create_map
+// is the repository's own entry point, ../../worldmap.cpp; -I. gives it this
+// directory's worldmap.h. For each problem the inputs climb to the
+// constraint limits (--quick stops at a tenth). Each answer is checked:
+//   festival    purchases replayed; optimal count against a subset brute
+//               force for N <= 10
+//   souvenirs   the mock seller's rules (souvenirs_shop.h)
+//   triples     count_triples against an O(N^2) scan up to N = 5000, and the
+//               threaded count against the serial one beyond; construct_range
+//               for the height limits and its reported count
+//   worldmap    checkMap on every map
+//
+// Each case runs in a forked child. That gives it its own peak RSS and
+// allocation counters, and a crash fails the case without ending the run.
+// Wall time, allocations and the live-bytes high-water mark cover the
+// solver calls only (alloc_track.h); peak RSS covers the whole child, input
+// generation and reference included. Each solver phase marked with
+// ALLOC_PHASE is reported too (--phases, and always in --json).
+//
+// With --baseline, a case also fails when its time or a memory measure
+// grows past the slack over the baseline's: time by --time-slack, the
+// allocation counts, bytes and high-water marks (per phase too) and peak RSS
+// by --memory-slack. The exit code is 1 if any case failed.
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../world_map_gen.h"
+#include "../world_map_validate.h"
+#include "alloc_track.h"
+#include "festival.h"
+#include "souvenirs.h"
+#include "souvenirs_shop.h"
+#include "triples.h"
+#include "worldmap.h"
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+struct PhaseResult {
+    char name[40];
+    long long calls, allocations, bytes, peakBytes;
+};
+
+const int MAX_CASE_PHASES = 16;
+
+// What one case reports back to the parent through a pipe.
+struct CaseResult {
+    bool ok = true;
+    double ms = 0;
+    long long allocations = 0, bytes = 0, peakBytes = 0;  // over the solver calls
+    long peakKb = 0;
+    int phaseCount = 0;
+    PhaseResult phases[MAX_CASE_PHASES] = {};  // the solvers' ALLOC_PHASEs
+    char detail[160] = "";
+};
+
+// Solver time, accumulated over the calls a case makes. Allocations are
+// recorded under the "(solver calls)" phase, which is inclusive of the
+// argument copies the by-value entry points take.
+struct Meter {
+    CaseResult& result;
+
+    template <class F>
+    void operator()(F&& solve) {
+        static AllocPhase& calls = allocPhase("(solver calls)");
+        Clock::time_point t0 = Clock::now();
+        {
+            AllocScope scope(calls);
+            solve();
+        }
+        result.ms += chrono::duration<double, milli>(Clock::now() - t0).count();
+    }
+};
+
+static void fail(CaseResult& r, const string& why) {
+    if (!r.ok) return;
+    r.ok = false;
+    snprintf(r.detail, sizeof r.detail, "%s", why.c_str());
+}
+
+struct BenchCase {
+    string problem, name;
+    function<void(CaseResult&, Meter&, mt19937_64&)> run;
+};
+
+// ---- festival ----
+
+// Replays a purchase order; -1 if it is not a valid one, else its length.
+static int replayCoupons(long long A, const vector<int>& P, const vector<int>& T, const vector<int>& order) {
+    const __int128 CAP = (__int128)1 << 62;
+    vector<char> used(P.size(), 0);
+    __int128 tokens = A;
+    for (int c : order) {
+        if (c < 0 || c >= (int)P.size() || used[c] || tokens < P[c]) return -1;
+        used[c] = 1;
+        tokens = min(CAP, (tokens - P[c]) * T[c]);
+    }
+    return (int)order.size();
+}
+
+// Most coupons any order buys: the most tokens left after buying each
+// subset, over all orders, O(2^N N).
+static int bruteCoupons(long long A, const vector<int>& P, const vector<int>& T) {
+    int N = (int)P.size();
+    const long long CAP = 1LL << 40;
+    vector<long long> best(1 << N, -1);
+    best[0] = A;
+    int most = 0;
+    for (int mask = 0; mask < (1 << N); mask++) {
+        if (best[mask] < 0) continue;
+        most = max(most, __builtin_popcount(mask));
+        for (int c = 0; c < N; c++) {
+            if (mask >> c & 1 || best[mask] < P[c]) continue;
+            long long next = min(CAP, (best[mask] - P[c]) * T[c]);
+            best[mask | 1 << c] = max(best[mask | 1 << c], next);
+        }
+    }
+    return most;
+}
+
+// Lossy: A and the multiplier prices in [3/4, 1] of the price limit, so
+// each multiplier loses tokens and the DP phase does the choosing.
+static void randomCoupons(int N, int maxPrice, bool lossy, mt19937_64& rng, long long& A, vector<int>& P,
+                          vector<int>& T) {
+    auto draw = [&](int lo) { return lo + (int)(rng() % (unsigned long long)(maxPrice - lo + 1)); };
+    int floor = lossy ? maxPrice / 4 * 3 : 1;
+    A = draw(floor);
+    P.resize(N);
+    T.resize(N);
+    for (int i = 0; i < N; i++) {
+        T[i] = 1 + (int)(rng() % 4);
+        P[i] = draw(T[i] == 1 ? 1 : floor);
+    }
+}
+
+static void festivalCases(vector<BenchCase>& cases, bool quick) {
+    cases.push_back({"festival", "reference N<=10", [](CaseResult& r, Meter& meter, mt19937_64& rng) {
+                         long long A;
+                         vector<int> P, T, order;
+                         for (int t = 0; t < 2000 && r.ok; t++) {
+                             randomCoupons(1 + (int)(rng() % 10), t % 3 ? 1000000000 : 20, t % 3 == 2, rng, A, P, T);
+                             meter([&] { order = max_coupons((int)A, P, T); });
+                             int got = replayCoupons(A, P, T, order), want = bruteCoupons(A, P, T);
+                             if (got != want)
+                                 fail(r, "case " + to_string(t) + ": bought " + to_string(got) + ", best is " +
+                                             to_string(want));
+                         }
+                     }});
+    // Uniform prices snowball into buying everything; the lossy inputs stop
+    // after a few dozen.
+    for (int N : {1000, 10000, 100000, 200000}) {
+        if (quick && N > 20000) break;
+        for (bool lossy : {false, true}) {
+            cases.push_back({"festival", "N=" + to_string(N) + (lossy ? " lossy" : ""),
+                             [N, lossy](CaseResult& r, Meter& meter, mt19937_64& rng) {
+                                 long long A;
+                                 vector<int> P, T, order;
+                                 randomCoupons(N, 1000000000, lossy, rng, A, P, T);
+                                 meter([&] { order = max_coupons((int)A, P, T); });
+                                 int got = replayCoupons(A, P, T, order);
+                                 if (got < 0) fail(r, "invalid purchase order");
+                                 else snprintf(r.detail, sizeof r.detail, "%d coupons", got);
+                             }});
+        }
+    }
+}
+
+// ---- souvenirs ----
+
+static void souvenirsCases(vector<BenchCase>& cases, bool quick) {
+    for (int maxN : {10, 100}) {
+        int count = quick ? 200 : 2000;
+        cases.push_back({"souvenirs", "N<=" + to_string(maxN) + " x" + to_string(count),
+                         [maxN, count](CaseResult& r, Meter& meter, mt19937_64& rng) {
+                             CaseOptions options;
+                             options.maxN = maxN;
+                             long long transactions = 0, bound = 0;
+                             unsigned long long seed = rng();
+                             for (int t = 0; t < count && r.ok; t++) {
+                                 Shop s;
+                                 s.price = makePrices(seed + t, options);
+                                 string error;
+                                 meter([&] { error = judge(s); });
+                                 if (!error.empty()) fail(r, "seed " + to_string(seed + t) + ": " + error);
+                                 transactions += s.transactions;
+                                 bound += transactionBound(s.price);
+                             }
+                             if (r.ok)
+                                 snprintf(r.detail, sizeof r.detail, "%.1f transactions/case, %.2fx the bound",
+                                          (double)transactions / count, (double)transactions / bound);
+                         }});
+    }
+}
+
+// ---- triples ----
+
+// O(N^2): for each pair i < k the middle j is i or k offset by one of their
+// heights.
+static long long slowTriples(const vector<int>& H) {
+    int N = (int)H.size();
+    long long count = 0;
+    for (int i = 0; i < N; i++) {
+        for (int k = i + 2; k < N; k++) {
+            int js[4] = {i + H[i], k - H[i], i + H[k], k - H[k]};
+            sort(js, js + 4);
+            for (int n = 0; n < 4; n++) {
+                int j = js[n];
+                if (j <= i || j >= k || (n && j == js[n - 1])) continue;
+                int h[3] = {H[i], H[j], H[k]}, d[3] = {j - i, k - j, k - i};
+                sort(h, h + 3);
+                sort(d, d + 3);
+                count += h[0] == d[0] && h[1] == d[1] && h[2] == d[2];
+            }
+        }
+    }
+    return count;
+}
+
+// Uniform small heights, which give many near-misses, or all of [1, N - 1].
+static vector<int> randomHeights(int N, mt19937_64& rng) {
+    int cap = rng() % 2 ? 10 : N - 1;
+    vector<int> H(N);
+    for (int& h : H) h = 1 + (int)(rng() % (unsigned long long)min(cap, N - 1));
+    return H;
+}
+
+static void triplesCases(vector<BenchCase>& cases, bool quick) {
+    for (int N : {1000, 5000, 50000, 200000}) {
+        if (quick && N > 20000) break;
+        cases.push_back({"triples", "count N=" + to_string(N), [N](CaseResult& r, Meter& meter, mt19937_64& rng) {
+                             vector<int> H = randomHeights(N, rng);
+                             long long got;
+                             meter([&] { got = count_triples(H); });
+                             long long want;
+                             if (N <= 5000) want = slowTriples(H);
+                             else want = count_triples(H, TripleCountOptions());
+                             if (got != want) fail(r, "counted " + to_string(got) + ", expected " + to_string(want));
+                             else snprintf(r.detail, sizeof r.detail, "%lld triples", got);
+                         }});
+    }
+    for (int M : {1000, 20000, 200000}) {
+        if (quick && M > 20000) break;
+        cases.push_back({"triples", "construct M=" + to_string(M), [M](CaseResult& r, Meter& meter, mt19937_64&) {
+                             RangeOptions options;
+                             options.maxMutations = 20000;  // fixed work, so timings compare across runs
+                             options.maxSeconds = 1e9;
+                             RangeReport report;
+                             vector<int> H;
+                             meter([&] { H = construct_range(M, INT_MAX, options, &report); });
+                             int N = (int)H.size();
+                             bool valid = N >= 3 && N <= M;
+                             for (int h : H) valid = valid && h >= 1 && h <= N - 1;
+                             if (!valid) fail(r, "heights out of range");
+                             else if (count_triples(H) != report.triples) fail(r, "reported count is wrong");
+                             else snprintf(r.detail, sizeof r.detail, "%lld triples", report.triples);
+                         }});
+    }
+}
+
+// ---- worldmap ----
+
+static void worldmapCases(vector<BenchCase>& cases, bool quick) {
+    for (int N : {10, 20, 30, 40}) {
+        int count = quick ? 20 : 200;
+        cases.push_back({"worldmap", "N=" + to_string(N) + " x" + to_string(count),
+                         [N, count](CaseResult& r, Meter& meter, mt19937_64& rng64) {
+                             mt19937 rng((uint32_t)rng64());
+                             double ratio = 0;
+                             for (int t = 0; t < count && r.ok; t++) {
+                                 GraphCase g = t % 4 == 0   ? genTree(N, rng)
+                                               : t % 4 == 1 ? genUniversal(N, 0.3, rng)
+                                               : t % 4 == 2 ? genClique(N)
+                                                            : genRandom(N, 0.2, rng);
+                                 vector<vector<int>> map;
+                                 meter([&] { map = create_map(g.N, g.M, g.A, g.B); });
+                                 EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+                                 if (!checkMap(Grid::fromVectors(map), graph).ok())
+                                     fail(r, "graph " + to_string(t) + ": invalid map");
+                                 ratio += (double)map.size() / N;
+                             }
+                             if (r.ok) snprintf(r.detail, sizeof r.detail, "mean K/N %.3f", ratio / count);
+                         }});
+    }
+}
+
+// ---- runner ----
+
+// Moves the tracker's report into the result: the "(solver calls)" phase
+// gives the case's totals, the rest are listed.
+static void collectPhases(CaseResult& r) {
+    for (const AllocPhaseReport& p : allocReport()) {
+        if (!strcmp(p.name, "(solver calls)")) {
+            r.allocations = p.allocations;
+            r.bytes = p.bytes;
+            r.peakBytes = p.peakBytes;
+        } else if (r.phaseCount < MAX_CASE_PHASES) {
+            PhaseResult& out = r.phases[r.phaseCount++];
+            snprintf(out.name, sizeof out.name, "%s", p.name);
+            out.calls = p.calls;
+            out.allocations = p.allocations;
+            out.bytes = p.bytes;
+            out.peakBytes = p.peakBytes;
+        }
+    }
+}
+
+static CaseResult runIsolated(const BenchCase& c, unsigned long long seed) {
+    CaseResult result;
+    int fds[2];
+    if (pipe(fds) != 0) {
+        fail(result, "pipe failed");
+        return result;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        allocReset();
+        CaseResult r;
+        Meter meter{r};
+        mt19937_64 rng(seed);
+        c.run(r, meter, rng);
+        collectPhases(r);
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        r.peakKb = usage.ru_maxrss;
+        ssize_t written = write(fds[1], &r, sizeof r);
+        _exit(written == (ssize_t)sizeof r ? 0 : 1);
+    }
+    close(fds[1]);
+    size_t got = 0;
+    for (ssize_t n; pid > 0 && got < sizeof result && (n = read(fds[0], (char*)&result + got, sizeof result - got)) > 0;)
+        got += n;
+    close(fds[0]);
+    int status = 0;
+    if (pid > 0) waitpid(pid, &status, 0);
+    if (got != sizeof result) {
+        result = CaseResult();
+        fail(result, WIFSIGNALED(status) ? "crashed: " + string(strsignal(WTERMSIG(status))) : "no result");
+    }
+    return result;
+}
+
+// ---- baseline ----
+
+// One case of an earlier --json run.
+struct Baseline {
+    double ms = 0;
+    long long peakKb = 0, allocations = 0, bytes = 0, peakBytes = 0;
+    map<string, long long> phasePeak;
+};
+
+// Value of "key": in `line` at or after `from`; the reader only has to
+// understand what printJson writes, one case per line.
+static string jsonValue(const string& line, const string& key, size_t from = 0) {
+    size_t at = line.find("\"" + key + "\": ", from);
+    if (at == string::npos) return "";
+    at += key.size() + 4;
+    if (line[at] == '"') return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+    return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+static bool readBaseline(const string& path, map<string, Baseline>& out) {
+    ifstream in(path);
+    if (!in) return false;
+    for (string line; getline(in, line);) {
+        string problem = jsonValue(line, "problem");
+        if (problem.empty()) continue;
+        Baseline& b = out[problem + "/" + jsonValue(line, "case")];
+        b.ms = atof(jsonValue(line, "ms").c_str());
+        b.peakKb = atoll(jsonValue(line, "peak_kb").c_str());
+        b.allocations = atoll(jsonValue(line, "allocations").c_str());
+        b.bytes = atoll(jsonValue(line, "allocated_bytes").c_str());
+        b.peakBytes = atoll(jsonValue(line, "peak_bytes").c_str());
+        for (size_t at = line.find("{\"phase\": "); at != string::npos; at = line.find("{\"phase\": ", at + 1))
+            b.phasePeak[jsonValue(line, "phase", at)] = atoll(jsonValue(line, "peak_bytes", at).c_str());
+    }
+    return true;
+}
+
+// Allowed growth over the baseline: a ratio and an absolute floor, so noise
+// on tiny cases does not fail the run. The memory measures repeat exactly
+// for a seed; time is the noisy one.
+struct Slack {
+    double time = 2.0, memory = 1.1;
+};
+
+static bool exceeds(double now, double before, double ratio, double floor) { return now > before * ratio + floor; }
+
+// The first measure that grew past its slack, or empty.
+static string regression(const CaseResult& r, const Baseline& b, const Slack& slack) {
+    char why[160] = "";
+    if (exceeds(r.ms, b.ms, slack.time, 1.0))
+        snprintf(why, sizeof why, "time %.2f ms, baseline %.2f ms", r.ms, b.ms);
+    else if (exceeds(r.peakBytes, b.peakBytes, slack.memory, 4096))
+        snprintf(why, sizeof why, "live peak %lld bytes, baseline %lld", r.peakBytes, b.peakBytes);
+    else if (exceeds(r.bytes, b.bytes, slack.memory, 4096))
+        snprintf(why, sizeof why, "allocated %lld bytes, baseline %lld", r.bytes, b.bytes);
+    else if (exceeds(r.allocations, b.allocations, slack.memory, 16))
+        snprintf(why, sizeof why, "%lld allocations, baseline %lld", r.allocations, b.allocations);
+    else if (exceeds(r.peakKb, b.peakKb, slack.memory, 1024))
+        snprintf(why, sizeof why, "peak RSS %ld KB, baseline %lld KB", r.peakKb, b.peakKb);
+    for (int i = 0; i < r.phaseCount && !why[0]; i++) {
+        auto it = b.phasePeak.find(r.phases[i].name);
+        if (it != b.phasePeak.end() && exceeds(r.phases[i].peakBytes, it->second, slack.memory, 4096))
+            snprintf(why, sizeof why, "%s live peak %lld bytes, baseline %lld", r.phases[i].name,
+                     r.phases[i].peakBytes, it->second);
+    }
+    return why;
+}
+
+// ---- output ----
+
+static void printJson(const BenchCase& c, const CaseResult& r, bool first) {
+    printf("%s  {\"problem\": \"%s\", \"case\": \"%s\", \"ok\": %s, \"ms\": %.3f, \"peak_kb\": %ld, "
+           "\"allocations\": %lld, \"allocated_bytes\": %lld, \"peak_bytes\": %lld, \"phases\": [",
+           first ? "" : ",\n", c.problem.c_str(), c.name.c_str(), r.ok ? "true" : "false", r.ms, r.peakKb,
+           r.allocations, r.bytes, r.peakBytes);
+    for (int i = 0; i < r.phaseCount; i++) {
+        const PhaseResult& p = r.phases[i];
+        printf("%s{\"phase\": \"%s\", \"calls\": %lld, \"allocations\": %lld, \"allocated_bytes\": %lld, "
+               "\"peak_bytes\": %lld}",
+               i ? ", " : "", p.name, p.calls, p.allocations, p.bytes, p.peakBytes);
+    }
+    printf("]%s%s%s}", r.ok ? "" : ", \"error\": \"", r.ok ? "" : r.detail, r.ok ? "" : "\"");
+}
+
+static void printText(const BenchCase& c, const CaseResult& r, bool phases) {
+    printf("%-10s %-22s %-4s %10.2f ms  rss %7.1f MB  live %7.1f MB  %9lld allocs (%8.1f MB)  %s\n",
+           c.problem.c_str(), c.name.c_str(), r.ok ? "ok" : "FAIL", r.ms, r.peakKb / 1024.0, r.peakBytes / 1048576.0,
+           r.allocations, r.bytes / 1048576.0, r.detail);
+    for (int i = 0; phases && i < r.phaseCount; i++) {
+        const PhaseResult& p = r.phases[i];
+        printf("    %-30s %8lld calls  live %7.1f MB  %9lld allocs (%8.1f MB)\n", p.name, p.calls,
+               p.peakBytes / 1048576.0, p.allocations, p.bytes / 1048576.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    string problem = "all", baselinePath;
+    unsigned long long seed = 1;
+    bool quick = false, json = false, phases = false;
+    Slack slack;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strncmp(a, "--problem=", 10)) problem = a + 10;
+        else if (!strncmp(a, "--seed=", 7)) seed = strtoull(a + 7, nullptr, 10);
+        else if (!strcmp(a, "--quick")) quick = true;
+        else if (!strcmp(a, "--json")) json = true;
+        else if (!strcmp(a, "--phases")) phases = true;
+        else if (!strncmp(a, "--baseline=", 11)) baselinePath = a + 11;
+        else if (!strncmp(a, "--time-slack=", 13)) slack.time = atof(a + 13);
+        else if (!strncmp(a, "--memory-slack=", 15)) slack.memory = atof(a + 15);
+        else {
+            fprintf(stderr,
+                    "usage: %s [--problem=all|festival|souvenirs|triples|worldmap] [--seed=S] [--quick] [--json]\n"
+                    "       [--phases] [--baseline=FILE] [--time-slack=2.0] [--memory-slack=1.1]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    map<string, Baseline> baseline;
+    if (!baselinePath.empty() && !readBaseline(baselinePath, baseline)) {
+        fprintf(stderr, "cannot read %s\n", baselinePath.c_str());
+        return 2;
+    }
+
+    vector<BenchCase> cases;
+    festivalCases(cases, quick);
+    souvenirsCases(cases, quick);
+    triplesCases(cases, quick);
+    worldmapCases(cases, quick);
+
+    int failures = 0, ran = 0;
+    if (json) printf("[\n");
+    for (size_t i = 0; i < cases.size(); i++) {
+        const BenchCase& c = cases[i];
+        if (problem != "all" && problem != c.problem) continue;
+        CaseResult r = runIsolated(c, seed + i);
+        auto base = baseline.find(c.problem + "/" + c.name);
+        if (r.ok && base != baseline.end()) {
+            string why = regression(r, base->second, slack);
+            if (!why.empty()) fail(r, "regressed: " + why);
+        }
+        failures += !r.ok;
+        if (json) printJson(c, r, ran == 0);
+        else printText(c, r, phases);
+        ran++;
+    }
+    if (json) printf("\n]\n");
+    if (!ran) {
+        fprintf(stderr, "no cases for --problem=%s\n", problem.c_str());
+        return 2;
+    }
+    return failures ? 1 : 0;
+}
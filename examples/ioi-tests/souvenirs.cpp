@@ -1,11 +1,147 @@
 #include "souvenirs.h"
+#include "alloc_track.h"
+#include <cstddef>
 #include <utility>
 #include <vector>
 
-void buy_souvenirs(int N, long long P0) {
+// What the transactions so far have revealed. Each transaction is one
+// linear equation: the prices of the types it bought sum to the coins
+// spent. Known prices are substituted as they are learned, so an equation
+// holds only its unknown types and what they still sum to; one left with a
+// single type gives that type's price, which may resolve others in turn.
+// All sums are of prices below P[0] <= 1e15 and stay in 64 bits.
+struct Inference {
+    std::vector<long long> price;   // -1 while unknown
+    std::vector<int> residual;      // souvenirs of type i still to buy
+    struct Equation {
+        std::vector<int> unknown;   // increasing
+        long long sum;
+    };
+    std::vector<Equation> equations;
+    std::vector<std::vector<int>> containing;  // type -> equations it was unknown in
+
+    Inference(int N, long long P0) : price(N, -1), residual(N), containing(N) {
+        for (int i = 0; i < N; i++) residual[i] = i;
+        price[0] = P0;
+    }
+
+    // Transacts M; returns the index of its equation.
+    int buy(long long M) {
+        auto [L, R] = transaction(M);
+        Equation e{{}, M - R};
+        for (int x : L) {
+            residual[x]--;
+            if (price[x] < 0) e.unknown.push_back(x);
+            else e.sum -= price[x];
+        }
+        int id = (int)equations.size();
+        for (int x : e.unknown) containing[x].push_back(id);
+        equations.push_back(std::move(e));
+        if (equations[id].unknown.size() == 1) know(equations[id].unknown[0], equations[id].sum);
+        return id;
+    }
 
+    void know(int x, long long p) {
+        price[x] = p;
+        std::vector<int> solved;
+        for (int id : containing[x]) {
+            Equation& e = equations[id];
+            for (std::size_t k = 0; k < e.unknown.size(); k++) {
+                if (e.unknown[k] != x) continue;
+                e.unknown.erase(e.unknown.begin() + k);
+                e.sum -= p;
+                if (e.unknown.size() == 1) solved.push_back(id);
+                break;
+            }
+        }
+        for (int id : solved) {
+            const Equation& e = equations[id];
+            if (e.unknown.size() == 1 && price[e.unknown[0]] < 0) know(e.unknown[0], e.sum);
+        }
+    }
+};
+
+// Transacts M, then learns the price of every type bought. While the U
+// unknown types of its equation sum to t, transacts floor(t / |U|): the
+// prices are distinct, so that is below the first one's price and at least
+// the last one's, and it only buys later types. A known type inside U's
+// span affordable at that amount could be all it buys, again and again;
+// the amount then drops below its price so the sweep starts past it.
+static void learn(Inference& inf, long long M) {
+    ALLOC_PHASE("buy_souvenirs/learn");
+    int id = inf.buy(M);
+    for (;;) {
+        const Inference::Equation& e = inf.equations[id];
+        if (e.unknown.size() <= 1) return;
+        const std::vector<int>& U = e.unknown;
+        long long next = e.sum / (long long)U.size();
+        for (int j = U.back() - 1; j > U[0]; j--) {
+            if (inf.price[j] >= 0 && inf.price[j] <= next) {
+                next = inf.price[j] - 1;
+                break;
+            }
+        }
+        learn(inf, next);
+    }
 }
 
-std::pair<std::vector<int>, long long> transaction(long long M) {
-    return {{}, 0};
+// The seller's sweep, simulated on known prices: the coins it spends for M,
+// or the amount to take off M if it would buy a type with nothing
+// outstanding (as a negative number). Taking that much off makes the sweep
+// reach that type with less than its price, though earlier purchases may
+// then change, so the caller simulates again.
+static long long simulate(const Inference& inf, long long M) {
+    long long pile = M;
+    for (int j = 0; j < (int)inf.price.size(); j++) {
+        if (pile < inf.price[j]) continue;
+        if (inf.residual[j] == 0) return -(pile - inf.price[j] + 1);
+        pile -= inf.price[j];
+    }
+    return M - pile;
+}
+
+// With every price known, each transaction can be planned. Every type with
+// nothing outstanding, and type 0, is a barrier: the pile must reach it
+// short of its price. A sweep starting just below a barrier's price covers
+// the run of outstanding types after it, so each barrier z gives a
+// candidate M = P[z] - 1. A candidate is lowered until its sweep clears
+// every barrier, and the one spending the most coins is transacted: each
+// transaction spends under P[0], so coins are what bound the count.
+static void top_up(Inference& inf) {
+    ALLOC_PHASE("buy_souvenirs/top_up");
+    int N = (int)inf.price.size();
+    for (;;) {
+        long long bestM = 0, bestSpent = 0;
+        for (int z = 0; z + 1 < N; z++) {
+            if (inf.residual[z] > 0 || inf.residual[z + 1] == 0) continue;
+            long long M = inf.price[z] - 1, spent;
+            while (M > 0 && (spent = simulate(inf, M)) < 0) M += spent;
+            if (M > 0 && spent > bestSpent) bestM = M, bestSpent = spent;
+        }
+        if (bestSpent == 0) return;
+        inf.buy(bestM);
+    }
+}
+
+// Prices are learned left to right: with P[i - 1] known, transacting
+// P[i - 1] - 1 buys type i first, and the souvenirs bought while learning
+// count towards the i copies of type i. What is still outstanding is then
+// bought in planned transactions that each take several souvenirs.
+//
+// Learning never buys more than i of type i. The first type a learning
+// transaction buys is unknown when it is made (learn() lowers the amount
+// past every known type it could start on), and it is known once that
+// learn() returns. Everything transacted in between starts after the
+// first unknown type of some equation, so later than that type. So no two
+// learning transactions start on the same type. A transaction that buys
+// type i starts on one of types 1..i, so at most i of them buy it. top_up()
+// simulates on exact prices and never buys a type with nothing outstanding.
+// souvenirs_grader.cpp --exhaustive checks this on every small price set.
+void buy_souvenirs(int N, long long P0) {
+    ALLOC_PHASE("buy_souvenirs");
+    Inference inf(N, P0);
+    for (int i = 1; i < N; i++) {
+        if (inf.price[i] < 0) learn(inf, inf.price[i - 1] - 1);
+    }
+    top_up(inf);
 }
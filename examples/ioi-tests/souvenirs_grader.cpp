@@ -0,0 +1,169 @@
+// In-process mock grader for souvenirs.
+//
+//   g++ -std=c++20 -O2 souvenirs_grader.cpp souvenirs_shop.cpp souvenirs.cpp -o souvenirs_grader
+//   ./souvenirs_grader < case.in
+//   ./souvenirs_grader --random=COUNT [--seed=1] [--max-n=100] [--max-p=1e15]
+//   ./souvenirs_grader --replay=SEED [--max-n=100] [--max-p=1e15]
+//   ./souvenirs_grader --exhaustive=MAX_P
+//
+// Without flags it reads one case in the sample grader's format (N, then
+// P[0..N-1]) and prints Q[0..N-1] like the sample grader, with the
+// transaction and coin counts on stderr.
+//
+// --random runs COUNT cases. Case i is built from seed + i using the price
+// families from the subtasks, picked round-robin. Each case is a fresh shop
+// and a fresh call to buy_souvenirs, so the solution must not keep state
+// between calls, just as under the real grader.
+//
+// The seller (transaction() and the rule checks) is souvenirs_shop.cpp.
+// After the call, the bought counts must be exactly Q[i] = i.
+//
+// --exhaustive runs every strictly decreasing price list with P[0] <= MAX_P
+// (at most 20) and N >= 2: each subset of 1..MAX_P with at least two
+// members, 2^MAX_P cases in all. Small prices are where the sweeps overlap
+// most, so this is where buying more than Q[i] would show.
+//
+// A failure is reported with its seed, and --replay prints that case's
+// prices and every transaction. The summary gives the number of
+// transactions (the real cost: each one is a round trip), as a multiple of
+// the lower bound every strategy is held to, and the coins handed over, per
+// family and in total.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "souvenirs.h"
+#include "souvenirs_shop.h"
+
+using namespace std;
+
+struct Tally {
+    long long cases = 0, transactions = 0, maxTransactions = 0, bound = 0;
+    double coins = 0;
+
+    void add(const Shop& s) {
+        cases++;
+        transactions += s.transactions;
+        maxTransactions = max(maxTransactions, s.transactions);
+        bound += transactionBound(s.price);
+        coins += (double)s.coins;
+    }
+
+    void print(const char* name) const {
+        if (!cases) return;
+        printf("%-12s cases=%lld transactions mean=%.1f max=%lld (%.2fx the bound) coins mean=%.3g\n", name,
+               cases, (double)transactions / cases, maxTransactions, (double)transactions / bound, coins / cases);
+    }
+};
+
+static int runRandom(unsigned long long count, unsigned long long seed, const CaseOptions& options) {
+    auto start = chrono::steady_clock::now();
+    Tally total, family[FAMILIES];
+    long long failures = 0;
+    for (unsigned long long i = 0; i < count; i++) {
+        Shop s;
+        s.price = makePrices(seed + i, options);
+        string error = judge(s);
+        if (!error.empty()) {
+            if (failures++ < 20) fprintf(stderr, "seed %llu: %s\n", seed + i, error.c_str());
+            continue;
+        }
+        total.add(s);
+        family[familyOf(seed + i)].add(s);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (int f = 0; f < FAMILIES; f++) family[f].print(FAMILY_NAMES[f]);
+    total.print("total");
+    printf("%llu cases, %lld failed, %.2f s (%.0f cases/s)\n", count, failures, seconds, count / seconds);
+    return failures ? 1 : 0;
+}
+
+static int runExhaustive(int maxP) {
+    Tally total;
+    long long failures = 0;
+    for (unsigned mask = 0; mask < (1u << maxP); mask++) {
+        if (__builtin_popcount(mask) < 2) continue;
+        Shop s;
+        for (int p = maxP; p >= 1; p--) {
+            if (mask >> (p - 1) & 1) s.price.push_back(p);
+        }
+        string error = judge(s);
+        if (!error.empty()) {
+            if (failures++ < 20) {
+                fprintf(stderr, "P =");
+                for (long long p : s.price) fprintf(stderr, " %lld", p);
+                fprintf(stderr, ": %s\n", error.c_str());
+            }
+            continue;
+        }
+        total.add(s);
+    }
+    total.print("total");
+    printf("%lld cases, %lld failed\n", total.cases + failures, failures);
+    return failures ? 1 : 0;
+}
+
+static int replay(unsigned long long seed, const CaseOptions& options) {
+    Shop s;
+    s.price = makePrices(seed, options);
+    s.log = true;
+    printf("seed %llu (%s): N=%d P =", seed, FAMILY_NAMES[familyOf(seed)], (int)s.price.size());
+    for (long long p : s.price) printf(" %lld", p);
+    printf("\n");
+    string error = judge(s);
+    printf("%lld transactions (bound %lld), %lld coins: %s\n", s.transactions, transactionBound(s.price), s.coins,
+           error.empty() ? "OK" : error.c_str());
+    return error.empty() ? 0 : 1;
+}
+
+// The sample grader's format.
+static int runSample() {
+    Shop s;
+    int N;
+    if (scanf("%d", &N) != 1) return 2;
+    s.price.resize(N);
+    for (long long& p : s.price) {
+        if (scanf("%lld", &p) != 1) return 2;
+    }
+    string error = judge(s);
+    if (!error.empty() && error.rfind("bought", 0) != 0) {
+        printf("Output isn't correct: %s\n", error.c_str());
+        return 1;
+    }
+    for (int i = 0; i < N; i++) printf(i ? " %d" : "%d", s.bought[i]);
+    printf("\n");
+    fprintf(stderr, "%lld transactions, %lld coins%s%s\n", s.transactions, s.coins, error.empty() ? "" : ": ",
+            error.c_str());
+    return error.empty() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    CaseOptions options;
+    unsigned long long count = 0, seed = 1;
+    long long replaySeed = -1;
+    int exhaustive = 0;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strncmp(a, "--random=", 9)) count = strtoull(a + 9, nullptr, 10);
+        else if (!strncmp(a, "--seed=", 7)) seed = strtoull(a + 7, nullptr, 10);
+        else if (!strncmp(a, "--max-n=", 8)) options.maxN = max(3, min(100, atoi(a + 8)));
+        else if (!strncmp(a, "--max-p=", 8)) options.maxP = (long long)atof(a + 8);
+        else if (!strncmp(a, "--replay=", 9)) replaySeed = atoll(a + 9);
+        else if (!strncmp(a, "--exhaustive=", 13)) exhaustive = max(2, min(20, atoi(a + 13)));
+        else {
+            fprintf(stderr, "usage: %s [--random=COUNT] [--seed=S] [--max-n=N] [--max-p=P] [--replay=SEED]"
+                    " [--exhaustive=MAX_P]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (exhaustive) return runExhaustive(exhaustive);
+    if (replaySeed >= 0) return replay((unsigned long long)replaySeed, options);
+    if (count) return runRandom(count, seed, options);
+    return runSample();
+}
@@ -0,0 +1,99 @@
+#include "souvenirs_shop.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "souvenirs.h"
+
+using namespace std;
+
+static Shop* shop = nullptr;  // set for the duration of one buy_souvenirs call
+
+pair<vector<int>, long long> transaction(long long M) {
+    if (!shop) throw Violation("transaction called outside buy_souvenirs");
+    const vector<long long>& P = shop->price;
+    if (M >= P[0] || M < P.back()) throw Violation("Invalid argument: M = " + to_string(M));
+    if (++shop->transactions > MAX_TRANSACTIONS) throw Violation("too many transactions");
+    shop->coins += M;
+    vector<int> L;
+    long long pile = M;
+    for (int i = 0; i < (int)P.size(); i++) {
+        if (pile >= P[i]) {
+            pile -= P[i];
+            L.push_back(i);
+            shop->bought[i]++;
+        }
+    }
+    if (shop->log) {
+        printf("transaction(%lld) -> [", M);
+        for (size_t k = 0; k < L.size(); k++) printf(k ? " %d" : "%d", L[k]);
+        printf("], %lld\n", pile);
+    }
+    return {L, pile};
+}
+
+string judge(Shop& s) {
+    int N = (int)s.price.size();
+    s.bought.assign(N, 0);
+    shop = &s;
+    string error;
+    try {
+        buy_souvenirs(N, s.price[0]);
+    } catch (const Violation& v) {
+        error = v.what();
+    }
+    shop = nullptr;
+    for (int i = 0; i < N && error.empty(); i++) {
+        if (s.bought[i] != i)
+            error = "bought " + to_string(s.bought[i]) + " of type " + to_string(i) + ", expected " + to_string(i);
+    }
+    return error;
+}
+
+vector<long long> makePrices(unsigned long long seed, const CaseOptions& options) {
+    mt19937_64 rng(seed);
+    auto uniform = [&rng](long long lo, long long hi) { return lo + (long long)(rng() % (unsigned long long)(hi - lo + 1)); };
+    Family family = familyOf(seed);
+    int N = family == Two ? 2 : family == Three ? 3 : (int)uniform(2, options.maxN);
+    vector<long long> P(N);
+    switch (family) {
+    case Consecutive:
+        for (int i = 0; i < N; i++) P[i] = N - i;
+        break;
+    case Tight:  // P[i] <= P[i + 1] + 2
+        P[N - 1] = uniform(1, 3);
+        for (int i = N - 2; i >= 0; i--) P[i] = P[i + 1] + uniform(1, 2);
+        break;
+    case Fibonacci: {  // P[i + 1] + P[i + 2] <= P[i] <= 2 P[i + 1], cut off before maxP
+        P.assign(1, uniform(1, 1000));
+        P.push_back(P[0] + uniform(1, P[0]));
+        while ((int)P.size() < N) {
+            long long lo = P.back() + P[P.size() - 2], hi = 2 * P.back();
+            if (hi > options.maxP) break;
+            P.push_back(uniform(lo, hi));
+        }
+        reverse(P.begin(), P.end());
+        break;
+    }
+    default: {
+        long long hi = max(options.maxP, (long long)N);
+        set<long long> drawn;
+        while ((int)drawn.size() < N) drawn.insert(uniform(1, hi));
+        P.assign(drawn.rbegin(), drawn.rend());
+    }
+    }
+    return P;
+}
+
+long long transactionBound(const vector<long long>& P) {
+    int N = (int)P.size();
+    __int128 cost = 0;
+    for (int i = 1; i < N; i++) cost += (__int128)i * P[i];
+    long long byCoins = (long long)((cost + P[0] - 2) / (P[0] - 1));
+    return max((long long)N - 1, byCoins);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// The seller behind transaction(), shared by souvenirs_grader.cpp and
+// ioi_bench.cpp. It simulates the sweep over P (O(N) per call) and throws a
+// Violation on any rule break:
+//   - M >= P[0] or M < P[N - 1] (the "Invalid argument" verdict);
+//   - more than 5000 calls;
+//   - a call made outside buy_souvenirs.
+
+const int MAX_TRANSACTIONS = 5000;
+
+struct Violation : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// The seller. `log` prints every transaction when set.
+struct Shop {
+    std::vector<long long> price;
+    std::vector<int> bought;
+    long long transactions = 0;
+    long long coins = 0;  // handed to the seller, returned change included
+    bool log = false;
+};
+
+// Runs buy_souvenirs against `s`: a fresh call per shop, so the solution
+// must not keep state between calls. Returns the violation, or a count
+// other than Q[i] = i, empty if none.
+std::string judge(Shop& s);
+
+enum Family { Uniform, Consecutive, Tight, Two, Three, Fibonacci, FAMILIES };
+
+inline const char* const FAMILY_NAMES[FAMILIES] = {"uniform", "consecutive", "tight", "n=2", "n=3", "fibonacci"};
+
+struct CaseOptions {
+    int maxN = 100;
+    long long maxP = 1000000000000000LL;
+};
+
+inline Family familyOf(unsigned long long seed) { return Family(seed % FAMILIES); }
+
+// Strictly decreasing prices in [1, maxP] of one subtask's shape, picked by
+// familyOf(seed).
+std::vector<long long> makePrices(unsigned long long seed, const CaseOptions& options);
+
+// No strategy needs fewer transactions: each buys at most one of every
+// type and spends under P[0] coins, and Q[i] = i costs sum i P[i] in all.
+// Loose when prices are close: with P[i] = N - i every sweep buys exactly
+// one souvenir, so N (N - 1) / 2 transactions are needed.
+long long transactionBound(const std::vector<long long>& P);
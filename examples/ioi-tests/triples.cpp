@@ -1,10 +1,330 @@
 #include "triples.h"
+#include "alloc_track.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+// Positions grouped by a key in [0, 3N): bucket x is at[begin[x], begin[x + 1]),
+// in increasing order. The keys used here, p + H[p] and p - H[p] + N, are
+// bounded, so a flat counting layout replaces a hash table and costs linear
+// memory.
+struct Buckets {
+    std::vector<int> begin, at;
+
+    Buckets(const std::vector<int>& key, int keys) : begin(keys + 1, 0), at(key.size()) {
+        for (int k : key) begin[k + 1]++;
+        for (int x = 0; x < keys; x++) begin[x + 1] += begin[x];
+        std::vector<int> next(begin.begin(), begin.end() - 1);
+        for (int p = 0; p < (int)key.size(); p++) at[next[key[p]]++] = p;
+    }
+
+    int size(int x) const { return x < 0 || x + 1 >= (int)begin.size() ? 0 : begin[x + 1] - begin[x]; }
+    const int* first(int x) const { return at.data() + begin[x]; }
+};
+
+// The buckets both middle cases read, shared read-only by every worker.
+struct TripleIndex {
+    const std::vector<int>& H;
+    Buckets bySum, byDiff;
+
+    static std::vector<int> keys(const std::vector<int>& H, int sign) {
+        int N = (int)H.size();
+        std::vector<int> key(N);
+        for (int p = 0; p < N; p++) key[p] = p + sign * H[p] + (sign < 0 ? N : 0);
+        return key;
+    }
+
+    explicit TripleIndex(const std::vector<int>& heights)
+        : H(heights), bySum(keys(heights, 1), 3 * (int)heights.size()),
+          byDiff(keys(heights, -1), 3 * (int)heights.size()) {}
+
+    // Triples whose peak of the largest height is in [lo, hi).
+    long long count(int lo, int hi) const;
+};
+
+// A triple i < j < k is mythical when {H[i], H[j], H[k]} = {j - i, k - j, k - i}.
+// The largest of the three distances, k - i, sits at exactly one of them, and
+// that splits the count into disjoint cases.
+//
+// H[i] = k - i or H[k] = k - i fixes k or i, and then each of the two ways
+// to place the other distances fixes j: O(N).
+//
+// H[j] = k - i with H[i] = j - i, H[k] = k - j: i + H[i] = j = k - H[k]. For
+// each j the smaller of the buckets {i : i + H[i] = j} and {k : k - H[k] = j}
+// is scanned, the partner being at distance H[j]; every position lies in one
+// bucket of each kind, so this is O(N) too.
+//
+// H[j] = k - i with H[i] = k - j, H[k] = j - i: i - H[i] = j - H[j] and
+// k + H[k] = j + H[j], and any i, k from those buckets with k - i = H[j]
+// completes the triple. Again the smaller bucket is scanned. Each j has its
+// own pair of keys, and at most sqrt(N) buckets of either kind hold more
+// than sqrt(N) positions: a j with a light bucket costs at most sqrt(N), and
+// a j between two heavy ones is one of at most N heavy pairs, which together
+// cost at most sqrt(N) * N. O(N sqrt N) overall.
+//
+// When the two smaller distances are equal, both placements of them are the
+// same triple; the second is skipped.
+long long TripleIndex::count(int lo, int hi) const {
+    int N = (int)H.size();
+    long long count = 0;
+    for (int i = lo; i < hi; i++) {
+        int k = i + H[i];
+        if (k >= N || H[k] >= H[i]) continue;
+        int j = k - H[k];  // H[j] = j - i, H[k] = k - j
+        if (H[j] == j - i) count++;
+        j = i + H[k];      // H[j] = k - j, H[k] = j - i
+        if (2 * H[k] != H[i] && H[j] == k - j) count++;
+    }
+    for (int k = lo; k < hi; k++) {
+        int i = k - H[k];
+        if (i < 0 || H[i] >= H[k]) continue;
+        int j = i + H[i];  // H[i] = j - i, H[j] = k - j
+        if (H[j] == k - j) count++;
+        j = k - H[i];      // H[i] = k - j, H[j] = j - i
+        if (2 * H[i] != H[k] && H[j] == j - i) count++;
+    }
+    for (int j = lo; j < hi; j++) {
+        int d = H[j];
+        // i in bySum[j], k in byDiff[j + N]
+        int left = bySum.size(j), right = byDiff.size(j + N);
+        if (left <= right) {
+            for (const int *p = bySum.first(j), *end = p + left; p < end; p++) {
+                int k = *p + d;
+                count += k < N && k - H[k] == j;
+            }
+        } else {
+            for (const int *p = byDiff.first(j + N), *end = p + right; p < end; p++) {
+                int i = *p - d;
+                count += i >= 0 && i + H[i] == j;
+            }
+        }
+        // i in byDiff[j - d + N], k in bySum[j + d]
+        left = byDiff.size(j - d + N), right = bySum.size(j + d);
+        if (left <= right) {
+            for (const int *p = byDiff.first(j - d + N), *end = p + left; p < end; p++) {
+                int i = *p, k = i + d;
+                count += k < N && k + H[k] == j + d && H[i] != H[k];
+            }
+        } else {
+            for (const int *p = bySum.first(j + d), *end = p + right; p < end; p++) {
+                int k = *p, i = k - d;
+                count += i >= 0 && i - H[i] == j - d && H[i] != H[k];
+            }
+        }
+    }
+    return count;
+}
+
 long long count_triples(std::vector<int> H) {
-    return 0;
+    ALLOC_PHASE("count_triples");
+    TripleIndex index(H);
+    return index.count(0, (int)H.size());
+}
+
+// Peaks per chunk: the heights and bucket offsets one chunk's positions
+// touch first stay within a core's L2.
+static const int TRIPLE_CHUNK = 4096;
+
+// Every index case only reads: the buckets are built once and each worker
+// claims chunks from a shared counter, one fetch per chunk, counting into
+// its own total. The totals are summed after the join.
+long long count_triples(const std::vector<int>& H, const TripleCountOptions& options) {
+    ALLOC_PHASE("count_triples threaded");
+    int N = (int)H.size();
+    TripleIndex index(H);
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    int chunks = (N + TRIPLE_CHUNK - 1) / TRIPLE_CHUNK;
+    threads = std::min<unsigned>(threads, std::max(1, chunks));
+
+    std::atomic<int> next{0};
+    std::vector<long long> total(threads, 0);
+    auto work = [&](unsigned w) {
+        long long local = 0;
+        for (int c; (c = next.fetch_add(1, std::memory_order_relaxed)) < chunks;)
+            local += index.count(c * TRIPLE_CHUNK, std::min(N, (c + 1) * TRIPLE_CHUNK));
+        total[w] = local;
+    };
+    std::vector<std::thread> workers;
+    for (unsigned w = 1; w < threads; w++) workers.emplace_back(work, w);
+    work(0);
+    for (std::thread& t : workers) t.join();
+
+    long long count = 0;
+    for (long long t : total) count += t;
+    if (options.verify) {
+        long long serial = index.count(0, N);
+        if (serial != count) throw std::logic_error("count_triples: parallel count differs from the serial one");
+        return serial;
+    }
+    return count;
 }
 
-std::vector<int> construct_range(int M, int K) {
-    return {};
+// count_triples kept current under single-height changes. The buckets are
+// intrusive lists over the positions (head per key, next / prev per
+// position), so moving a position between buckets is O(1).
+//
+// Every triple through p has H[p] equal to one of its distances:
+//   - to another member q = p +- H[p]; the third member r then has H[q] as
+//     its distance to q or to p, so r = q +- H[q] or p +- H[q];
+//   - between the other two members x and y = x +- H[p]; then one of them,
+//     x, is either at distance H[x] from p (x + H[x] = p or x - H[x] = p),
+//     or shares p's key (x - H[x] = p - H[p] or x + H[x] = p + H[p]).
+// So the triples through p are among 8 candidates plus two per member of
+// four buckets, and a change at p costs the size of those buckets.
+class TripleCounter {
+public:
+    explicit TripleCounter(std::vector<int> heights)
+        : H(std::move(heights)), N((int)H.size()), head_(2 * 3 * (size_t)N, -1), next_(2 * (size_t)N),
+          prev_(2 * (size_t)N) {
+        for (int p = 0; p < N; p++) link(p);
+        total_ = count_triples(H);
+    }
+
+    long long total() const { return total_; }
+    const std::vector<int>& heights() const { return H; }
+
+    void set(int p, int h) {
+        total_ -= through(p);
+        unlink(p);
+        H[p] = h;
+        link(p);
+        total_ += through(p);
+    }
+
+private:
+    // List 0 keys position p by p + H[p], list 1 by p - H[p] + N; node
+    // 2p + list in next_ / prev_.
+    int key(int p, int list) const { return list ? p - H[p] + N : p + H[p]; }
+    int& first(int list, long long key) { return head_[list * 3 * (size_t)N + key]; }
+
+    void link(int p) {
+        for (int list = 0; list < 2; list++) {
+            int node = 2 * p + list, &h = first(list, key(p, list));
+            next_[node] = h;
+            prev_[node] = -1;
+            if (h >= 0) prev_[h] = node;
+            h = node;
+        }
+    }
+
+    void unlink(int p) {
+        for (int list = 0; list < 2; list++) {
+            int node = 2 * p + list;
+            if (prev_[node] >= 0) next_[prev_[node]] = next_[node];
+            else first(list, key(p, list)) = next_[node];
+            if (next_[node] >= 0) prev_[next_[node]] = prev_[node];
+        }
+    }
+
+    bool mythical(int i, int j, int k) const {
+        int h[3] = {H[i], H[j], H[k]}, d[3] = {j - i, k - j, k - i};
+        std::sort(h, h + 3);
+        if (d[0] > d[1]) std::swap(d[0], d[1]);
+        return h[0] == d[0] && h[1] == d[1] && h[2] == d[2];
+    }
+
+    // Triples that contain p.
+    long long through(int p) {
+        candidates_.clear();
+        auto add = [&](long long a, long long b) {
+            if (a < 0 || b < 0 || a >= N || b >= N || a == p || b == p || a == b) return;
+            int x[3] = {p, (int)a, (int)b};
+            std::sort(x, x + 3);
+            candidates_.push_back({x[0], x[1], x[2]});
+        };
+        int h = H[p];
+        for (long long q : {(long long)p - h, (long long)p + h}) {
+            if (q < 0 || q >= N) continue;
+            int g = H[q];
+            for (long long r : {q - g, q + g, (long long)p - g, (long long)p + g}) add(q, r);
+        }
+        auto scan = [&](int list, long long key) {
+            if (key < 0 || key >= 3 * (long long)N) return;
+            for (int node = first(list, key); node >= 0; node = next_[node]) {
+                int x = node >> 1;
+                add(x, (long long)x - h);
+                add(x, (long long)x + h);
+            }
+        };
+        scan(0, p);
+        scan(1, (long long)p + N);
+        scan(1, (long long)p - h + N);
+        scan(0, (long long)p + h);
+        std::sort(candidates_.begin(), candidates_.end());
+        candidates_.erase(std::unique(candidates_.begin(), candidates_.end()), candidates_.end());
+        long long count = 0;
+        for (const auto& t : candidates_) count += mythical(t[0], t[1], t[2]);
+        return count;
+    }
+
+    std::vector<int> H;
+    int N;
+    std::vector<int> head_, next_, prev_;
+    std::vector<std::array<int, 3>> candidates_;
+    long long total_ = 0;
+};
+
+static bool is_prime(int p) {
+    if (p < 2) return false;
+    for (int d = 2; d * d <= p; d++) {
+        if (p % d == 0) return false;
+    }
+    return true;
+}
+
+// Give position x the pair of keys (x - H[x], x + H[x]). Three keys a < c < b
+// are a triple with the largest height in the middle exactly when the
+// positions keyed (a, c), (a, b) and (c, b) exist, i.e. a triangle, and
+// each position hosts one key pair, the one summing to 2x. A complete graph
+// on a Sidon set (all pairwise sums distinct) puts every pair on its own
+// position. The Erdos-Turan set 2pk + (k^2 mod p), k < p, shifted down by c
+// so that more pairs sum into [0, 2M), with p ~ 0.65 sqrt(M) and c a fifth
+// of its span, measured best over a grid of both: about C(p, 3) triples,
+// 2.45e6 at M = 200 000. Other positions get height 1.
+static std::vector<int> sidon_range(int M) {
+    ALLOC_PHASE("construct_range/seed");
+    int p = std::max(2, (int)(0.65 * std::sqrt((double)M)));
+    while (!is_prime(p)) p--;
+    long long span = 2LL * p * (p - 1) + p - 1, shift = span / 5;
+    std::vector<long long> key(p);
+    for (int k = 0; k < p; k++) key[k] = 2LL * p * k + (long long)k * k % p - shift;
+    std::vector<int> H(M, 1);
+    for (int a = 0; a < p; a++) {
+        for (int b = a + 1; b < p; b++) {
+            long long x = key[a] + key[b], h = key[b] - key[a];
+            if (x >= 0 && x < M && h < M) H[x] = (int)h;
+        }
+    }
+    return H;
 }
+
+std::vector<int> construct_range(int M, int K, const RangeOptions& options, RangeReport* report) {
+    ALLOC_PHASE("construct_range");
+    TripleCounter counter(sidon_range(M));
+    std::mt19937 rng(options.seed);
+    auto start = std::chrono::steady_clock::now();
+    long long mutations = 0, accepted = 0;
+    // Hill climbing the seed: random heights at random positions, kept when
+    // the count does not drop.
+    while (counter.total() < K && mutations < options.maxMutations) {
+        if ((mutations & 255) == 0 &&
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > options.maxSeconds)
+            break;
+        mutations++;
+        int p = (int)(rng() % M), old = counter.heights()[p];
+        long long before = counter.total();
+        counter.set(p, 1 + (int)(rng() % (M - 1)));
+        if (counter.total() < before) counter.set(p, old);
+        else accepted++;
+    }
+    if (report) *report = {M, counter.total(), mutations, accepted};
+    return counter.heights();
+}
+
+std::vector<int> construct_range(int M, int K) { return construct_range(M, K, RangeOptions()); }
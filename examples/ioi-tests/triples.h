@@ -0,0 +1,28 @@
+#include <vector>
+long long count_triples(std::vector<int> H);
+std::vector<int> construct_range(int M, int K);
+
+// Local additions, not part of the task interface.
+struct TripleCountOptions {
+    unsigned threads = 0;  // 0: one per hardware thread
+    bool verify = false;   // also count serially; throws std::logic_error on a mismatch
+};
+
+// count_triples split over threads; the result equals the serial count.
+long long count_triples(const std::vector<int>& H, const TripleCountOptions& options);
+
+struct RangeOptions {
+    long long maxMutations = 200000;  // local-search steps after the construction
+    double maxSeconds = 1.0;
+    unsigned seed = 1;
+};
+
+struct RangeReport {
+    int length = 0;
+    long long triples = 0;  // exact count of the returned array
+    long long mutations = 0, accepted = 0;
+};
+
+// construct_range with the local search bounded by `options`; the search
+// stops early once K triples are reached.
+std::vector<int> construct_range(int M, int K, const RangeOptions& options, RangeReport* report = nullptr);
@@ -1,6 +1,2 @@
-#include "worldmap.h"
 #include <vector>
-
-std::vector<std::vector<int>> create_map(int N, int M, std::vector<int> A, std::vector<int> B) {
-    return {};
-}
+std::vector<std::vector<int>> create_map(int N, int M, std::vector<int> A, std::vector<int> B);
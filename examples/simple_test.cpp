@@ -1,23 +1,31 @@
 #include <iostream>
+#include <string>
 #include <vector>
 using namespace std;
 
-#include "world_map.cpp"
+#include "world_map.h"
+#include "world_map_report.h"
+
+// Usage: simple_test [--quiet]  (quiet: size line only)
+// Build: g++ -std=c++20 -O2 simple_test.cpp world_map.cpp -lpthread
+int main(int argc, char** argv) {
+    bool quiet = argc > 1 && string(argv[1]) == "--quiet";
 
-int main() {
     // Simple test: linear chain
     vector<int> A = {1, 2, 3, 4};
     vector<int> B = {2, 3, 4, 5};
 
-    auto result = create_map(5, 4, A, B);
+    Grid result = build_map(5, 4, A, B);
 
-    cout << "Grid size: " << result.size() << "x" << result[0].size() << "\n";
-    for (auto& row : result) {
-        for (int val : row) {
-            cout << val << " ";
+    BufferedWriter out;
+    out << "Grid size: " << result.rows() << "x" << result.cols() << "\n";
+    if (!quiet) {
+        for (int r = 0; r < result.rows(); r++) {
+            for (int c = 0; c < result.cols(); c++) out << result.at(r, c) << " ";
+            out << "\n";
         }
-        cout << "\n";
     }
+    out.flush();
 
     return 0;
 }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "world_map_cache.h"
+#include "world_map_grid.h"
+#include "world_map_optimize.h"
+#include "world_map_portfolio.h"
+#include "world_map_registry.h"
+#include "world_map_search.h"
+#include "world_map_validate.h"
+
+// The world-map engine: one library, world_map.cpp, behind this header. The
+// grader entry point (../worldmap.cpp) and every driver here link it; none
+// of them carries its own copy of the special cases. From examples/:
+//
+//   g++ -std=c++20 -O2 world_map_test.cpp world_map.cpp -o world_map_test -lpthread
+//   g++ -std=c++20 -O2 simple_test.cpp world_map.cpp -o simple_test -lpthread
+//   g++ -std=c++20 -O2 world_map_bench.cpp world_map.cpp ioi-tests/alloc_track.cpp -o world_map_bench -lpthread
+//   g++ -std=c++20 -O2 world_map_fuzz.cpp world_map.cpp -o world_map_fuzz -lpthread
+//
+// and from the repository root, with the task's grader and worldmap.h:
+//
+//   g++ -std=c++20 -O2 grader.cpp worldmap.cpp examples/world_map.cpp -o worldmap -lpthread
+//
+// -DWORLD_MAP_STATS=1 must be given to every translation unit or to none.
+//
+// A graph is classified once (classifyGraph, O(N + M)) and handed to the
+// strategies registered for its class in world_map_registry.h.
+
+struct MapOptions {
+    SearchBudget budget;          // per graph, shared by the backtracking fallback and K minimisation
+    bool minimizeSide = false;    // binary-search the smallest K once a valid map is known
+    SideReport* report = nullptr; // filled when minimizeSide is set
+    MapCache* cache = nullptr;    // consulted first, and fed with every valid map built
+};
+
+// Builds the map into a contiguous grid, borrowing storage from `arena` when
+// one is supplied so batch callers can reuse a single buffer. With a cache,
+// a graph isomorphic (up to canonicalize()) to one seen before costs a
+// relabelling pass over the stored map instead of a solve.
+Grid build_map(const EdgeMatrix& graph, GridArena* arena = nullptr, const MapOptions& options = MapOptions());
+Grid build_map(int N, int M, std::span<const int> A, std::span<const int> B, GridArena* arena = nullptr,
+               const MapOptions& options = MapOptions());
+
+// Portfolio mode: races every registered strategy, differently rooted and
+// randomised greedy runs and the search on `pool`, keeping the valid map
+// with the smallest K. Falls back to build_map if no entry produces a valid
+// map.
+Grid build_map_portfolio(int N, int M, std::span<const int> A, std::span<const int> B, ThreadPool& pool,
+                         const PortfolioOptions& options = PortfolioOptions());
+
+// Graphs packed back to back: graph g has nodes[g] nodes and the edges
+// edges[2i], edges[2i + 1] for edgeBegin[g] <= i < edgeBegin[g + 1].
+struct GraphBatch {
+    std::vector<int> nodes;
+    std::vector<int> edgeBegin = {0};
+    std::vector<int> edges;
+
+    int size() const { return (int)nodes.size(); }
+
+    void clear() {
+        nodes.clear();
+        edgeBegin.assign(1, 0);
+        edges.clear();
+    }
+
+    void add(int N, int M, std::span<const int> A, std::span<const int> B) {
+        nodes.push_back(N);
+        for (int i = 0; i < M; i++) {
+            edges.push_back(A[i]);
+            edges.push_back(B[i]);
+        }
+        edgeBegin.push_back(edgeBegin.back() + M);
+    }
+};
+
+// Maps packed back to back: map g is rows[g] x cols[g] cells, row-major, at
+// cells[offset[g]]. Reusing one MapBatch across calls reuses its buffers.
+struct MapBatch {
+    std::vector<int> cells;
+    std::vector<size_t> offset;
+    std::vector<int> rows, cols;
+
+    int size() const { return (int)offset.size(); }
+
+    std::vector<std::vector<int>> toVectors(int g) const {
+        std::vector<std::vector<int>> map(rows[g], std::vector<int>(cols[g]));
+        const int* cell = cells.data() + offset[g];
+        for (int r = 0; r < rows[g]; r++, cell += cols[g]) std::copy(cell, cell + cols[g], map[r].begin());
+        return map;
+    }
+
+    // Per-worker cell buffers of a threaded build_maps(); kept for reuse.
+    std::vector<std::vector<int>> chunks;
+};
+
+// Builds a map for every graph of `batch` into `out`. Scratch (arenas,
+// placement and search state) is per thread and survives across graphs and
+// calls. With a pool, graphs are handed out to size() workers one at a time
+// and the workers' maps are packed into `out` once all are done.
+void build_maps(const GraphBatch& batch, MapBatch& out, const MapOptions& options, ThreadPool* pool = nullptr);
+
+// The grader's allowance per test: up to GRADER_CALLS_PER_TEST create_map
+// calls share GRADER_SECONDS_PER_TEST of search, split evenly, so a test
+// stays bounded however many of its graphs end in the search. The node cap
+// bounds each search stage on its own, in case the clock is coarse.
+const int GRADER_CALLS_PER_TEST = 50;
+const double GRADER_SECONDS_PER_TEST = 0.5;
+
+inline SearchBudget graderBudget() {
+    SearchBudget budget;
+    budget.maxSeconds = GRADER_SECONDS_PER_TEST / GRADER_CALLS_PER_TEST;
+    budget.maxNodes = 200000;
+    return budget;
+}
+
+// The production settings: K minimised within graderBudget(), maps kept in
+// `cache`.
+inline MapOptions graderOptions(MapCache* cache) {
+    MapOptions options;
+    options.budget = graderBudget();
+    options.minimizeSide = true;
+    options.cache = cache;
+    return options;
+}
+
+// build_maps with graderOptions() and a process-wide cache.
+void create_maps(const GraphBatch& batch, MapBatch& out, ThreadPool* pool = nullptr);
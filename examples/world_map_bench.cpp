@@ -0,0 +1,198 @@
+// Throughput and K/N benchmark for create_map over seeded graph families.
+//
+//   g++ -std=c++20 -O2 world_map_bench.cpp world_map.cpp ioi-tests/alloc_track.cpp -o world_map_bench -lpthread
+//   ./world_map_bench [--graphs=200] [--seed=1] [--default-options] [--strategies [--search-ms=50]] > bench.json
+//
+// For every family of world_map_gen.h, times create_map's engine
+// (build_map with the grader's options, graderOptions(), minus the
+// vector<vector<int>> conversion) and checkMap separately and prints one
+// JSON document with per-family latency percentiles, maps/sec, heap
+// allocations per call, max minimised K/N and the number of invalid maps.
+// The map is built into an arena and validated in place. One cache serves
+// the whole run, as the process-wide one serves the grader's calls.
+// --default-options times build_map with MapOptions() instead: no side
+// minimisation, no cache and the default search budget.
+// Allocations are counted by the replacement allocator of
+// ioi-tests/alloc_track.cpp, linked in.
+// Built with -DWORLD_MAP_STATS=1, each family also reports the builder's
+// counters and phase times (world_map_stats.h) averaged per call.
+//
+// --strategies also runs every registered strategy on its own over every
+// graph and reports latency, validity and K/N per (graph class, strategy),
+// "registered" marking the pairs the engine dispatches to: the data for
+// ordering the registry. The search gets --search-ms per graph.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ioi-tests/alloc_track.h"
+#include "world_map.h"
+#include "world_map_gen.h"
+#include "world_map_validate.h"
+
+using namespace std;
+
+struct FamilyStats {
+    vector<double> createUs, validateUs;
+    MapStats builder;  // summed over the family's calls
+    long long allocations = 0;
+    double maxRatio = 0;
+    int invalid = 0;
+};
+
+// One strategy run standalone on the graphs of one class.
+struct StrategyStats {
+    vector<double> us;
+    int empty = 0, valid = 0;
+    double maxRatio = 0;
+};
+
+static void addStats(MapStats& total, const MapStats& s) {
+    total.bfsPops += s.bfsPops;
+    total.canPlaceProbes += s.canPlaceProbes;
+    total.rejections += s.rejections;
+    total.fillCells += s.fillCells;
+    total.searchNodes += s.searchNodes;
+    total.adjacencyUs += s.adjacencyUs;
+    total.classifyUs += s.classifyUs;
+    total.layoutUs += s.layoutUs;
+    total.placementUs += s.placementUs;
+    total.fillUs += s.fillUs;
+    total.searchUs += s.searchUs;
+}
+
+static double percentile(vector<double> v, double q) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    size_t i = (size_t)(q * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+static double sum(const vector<double>& v) {
+    double s = 0;
+    for (double x : v) s += x;
+    return s;
+}
+
+int main(int argc, char** argv) {
+    int graphs = 200;
+    unsigned seed = 1;
+    bool strategies = false;
+    bool defaultOptions = false;
+    SearchBudget budget;
+    budget.maxSeconds = 0.05;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--graphs=", 9)) graphs = atoi(argv[i] + 9);
+        else if (!strncmp(argv[i], "--seed=", 7)) seed = (unsigned)strtoul(argv[i] + 7, nullptr, 10);
+        else if (!strcmp(argv[i], "--default-options")) defaultOptions = true;
+        else if (!strcmp(argv[i], "--strategies")) strategies = true;
+        else if (!strncmp(argv[i], "--search-ms=", 12)) budget.maxSeconds = atof(argv[i] + 12) / 1000;
+        else {
+            fprintf(stderr, "usage: %s [--graphs=N] [--seed=S] [--default-options] [--strategies [--search-ms=T]]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    typedef chrono::steady_clock Clock;
+    auto micros = [](Clock::duration d) { return chrono::duration<double, micro>(d).count(); };
+
+    vector<GraphFamily> families = graphFamilies();
+    span<const MapStrategy> registry = mapStrategies();
+    vector<vector<StrategyStats>> byClass(GRAPH_CLASSES, vector<StrategyStats>(registry.size()));
+    MapCache cache;
+    MapOptions options = defaultOptions ? MapOptions() : graderOptions(&cache);
+    printf("{\n  \"graphs_per_family\": %d,\n  \"seed\": %u,\n  \"options\": \"%s\",\n  \"families\": [\n", graphs,
+           seed, defaultOptions ? "default" : "grader");
+    for (size_t f = 0; f < families.size(); f++) {
+        const GraphFamily& family = families[f];
+        mt19937 rng(seed * 1000003u + (unsigned)f);
+        FamilyStats stats;
+        GridArena arena;
+        for (int i = 0; i < graphs; i++) {
+            GraphCase g = family.make(rng);
+            EdgeMatrix expected = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+
+            arena.reset();
+            mapStats().clear();
+            long long before = allocTotals().allocations;
+            Clock::time_point t0 = Clock::now();
+            Grid grid = build_map(g.N, g.M, g.A, g.B, &arena, options);
+            Clock::time_point t1 = Clock::now();
+            stats.allocations += allocTotals().allocations - before;
+            stats.createUs.push_back(micros(t1 - t0));
+            addStats(stats.builder, mapStats());
+
+            t0 = Clock::now();
+            MapCheck check = checkMap(grid, expected);
+            t1 = Clock::now();
+            stats.validateUs.push_back(micros(t1 - t0));
+
+            if (!check.ok()) stats.invalid++;
+            else stats.maxRatio = max(stats.maxRatio, (double)grid.side() / g.N);
+
+            if (!strategies) continue;
+            GraphClass cls = classifyGraph(expected).cls;
+            for (size_t k = 0; k < registry.size(); k++) {
+                StrategyStats& st = byClass[(int)cls][k];
+                arena.reset();
+                t0 = Clock::now();
+                Grid candidate = registry[k].build(expected, &arena, budget);
+                t1 = Clock::now();
+                st.us.push_back(micros(t1 - t0));
+                if (candidate.empty()) st.empty++;
+                else if (checkMap(candidate, expected).ok()) {
+                    st.valid++;
+                    st.maxRatio = max(st.maxRatio, (double)candidate.side() / g.N);
+                }
+            }
+        }
+
+        double totalUs = sum(stats.createUs);
+        printf("    {\"family\": \"%s\", \"subtask\": %d, \"graphs\": %d, ", family.name.c_str(),
+               family.subtask, graphs);
+        printf("\"create_us_p50\": %.2f, \"create_us_p99\": %.2f, ", percentile(stats.createUs, 0.5),
+               percentile(stats.createUs, 0.99));
+        printf("\"validate_us_p50\": %.2f, \"validate_us_p99\": %.2f, ", percentile(stats.validateUs, 0.5),
+               percentile(stats.validateUs, 0.99));
+        printf("\"maps_per_sec\": %.1f, \"allocs_per_call\": %.2f, ", totalUs > 0 ? graphs * 1e6 / totalUs : 0.0,
+               graphs ? (double)stats.allocations / graphs : 0.0);
+        printf("\"max_k_over_n\": %.3f, \"invalid\": %d", stats.maxRatio, stats.invalid);
+#if WORLD_MAP_STATS
+        const MapStats& s = stats.builder;
+        double per = graphs ? 1.0 / graphs : 0.0;
+        printf(", \"stats\": {\"bfs_pops\": %.2f, \"can_place_probes\": %.2f, \"rejections\": %.2f, "
+               "\"fill_cells\": %.2f, \"search_nodes\": %.2f, \"adjacency_us\": %.2f, \"classify_us\": %.2f, "
+               "\"layout_us\": %.2f, \"placement_us\": %.2f, \"fill_us\": %.2f, \"search_us\": %.2f}",
+               s.bfsPops * per, s.canPlaceProbes * per, s.rejections * per, s.fillCells * per, s.searchNodes * per,
+               s.adjacencyUs * per, s.classifyUs * per, s.layoutUs * per, s.placementUs * per, s.fillUs * per,
+               s.searchUs * per);
+#endif
+        printf("}%s\n", f + 1 < families.size() ? "," : "");
+    }
+    printf("  ]");
+
+    if (strategies) {
+        printf(",\n  \"strategies\": [");
+        const char* sep = "\n";
+        for (int c = 0; c < GRAPH_CLASSES; c++) {
+            for (size_t k = 0; k < registry.size(); k++) {
+                const StrategyStats& st = byClass[c][k];
+                if (st.us.empty()) continue;
+                printf("%s    {\"class\": \"%s\", \"strategy\": \"%s\", \"registered\": %s, \"graphs\": %zu, ", sep,
+                       graphClassName((GraphClass)c), registry[k].name,
+                       registry[k].appliesTo((GraphClass)c) ? "true" : "false", st.us.size());
+                printf("\"us_p50\": %.2f, \"us_p99\": %.2f, \"empty\": %d, \"valid\": %d, \"max_k_over_n\": %.3f}",
+                       percentile(st.us, 0.5), percentile(st.us, 0.99), st.empty, st.valid, st.maxRatio);
+                sep = ",\n";
+            }
+        }
+        printf("\n  ]");
+    }
+    printf("\n}\n");
+    return 0;
+}
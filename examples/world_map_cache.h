@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_validate.h"
+
+// A graph relabelled into canonical order, plus the relabelling itself.
+// toCanon[v] is the canonical label of node v, fromCanon[c] its inverse.
+struct CanonicalForm {
+    EdgeMatrix graph;
+    int toCanon[EdgeMatrix::MAX_NODES + 1] = {};
+    int fromCanon[EdgeMatrix::MAX_NODES + 1] = {};
+};
+
+// Colour refinement seeded with node degrees: a node's class is repeatedly
+// split by the multiset of its neighbours' classes until stable. While some
+// class still holds several nodes, the first node of the first such class
+// is individualised and refinement runs again, until every node is alone.
+//
+// This is not a complete canonical labelling (ties are broken by label, and
+// non-equivalent nodes can share a class in regular graphs). But the key is
+// the relabelled graph itself, so two graphs that canonicalise differently
+// only cost a cache miss, never a wrong map. Paths, stars, cliques and most
+// trees canonicalise identically whatever their input labels.
+inline CanonicalForm canonicalize(const EdgeMatrix& graph) {
+    const int MAX_NODES = EdgeMatrix::MAX_NODES;
+    int N = graph.n;
+    int cls[MAX_NODES + 1] = {};
+    int order[MAX_NODES];
+    for (int v = 1; v <= N; v++) {
+        cls[v] = __builtin_popcountll(graph.row[v]);
+        order[v - 1] = v;
+    }
+
+    // sig[v]: own class, then the neighbours' classes sorted; sigLen[v]
+    // entries. Fixed-size, so canonicalising does not allocate.
+    int sig[MAX_NODES + 1][MAX_NODES + 1];
+    int sigLen[MAX_NODES + 1];
+    auto less = [&](int a, int b) {
+        return std::lexicographical_compare(sig[a], sig[a] + sigLen[a], sig[b], sig[b] + sigLen[b]);
+    };
+    auto same = [&](int a, int b) { return sigLen[a] == sigLen[b] && std::equal(sig[a], sig[a] + sigLen[a], sig[b]); };
+    auto refine = [&] {
+        int classes = 0;
+        while (true) {
+            for (int v = 1; v <= N; v++) {
+                int len = 0;
+                sig[v][len++] = cls[v];
+                for (uint64_t m = graph.row[v]; m; m &= m - 1) sig[v][len++] = cls[__builtin_ctzll(m)];
+                std::sort(sig[v] + 1, sig[v] + len);
+                sigLen[v] = len;
+            }
+            // Insertion sort: stable like std::stable_sort, without its
+            // temporary buffer, and N <= 40.
+            for (int i = 1; i < N; i++) {
+                int v = order[i], j = i;
+                for (; j > 0 && less(v, order[j - 1]); j--) order[j] = order[j - 1];
+                order[j] = v;
+            }
+            int count = 0;
+            int next[MAX_NODES + 1];
+            for (int i = 0; i < N; i++) {
+                if (i == 0 || !same(order[i], order[i - 1])) count++;
+                next[order[i]] = count;
+            }
+            std::copy(next + 1, next + N + 1, cls + 1);
+            if (count == classes) return count;
+            classes = count;
+        }
+    };
+
+    for (int classes = refine(); classes < N; classes = refine()) {
+        int i = 0;
+        while (cls[order[i]] != cls[order[i + 1]]) i++;
+        int pick = order[i], tied = cls[pick];
+        for (int v = 1; v <= N; v++) cls[v] = 2 * cls[v] + (cls[v] == tied && v != pick);
+    }
+
+    CanonicalForm form;
+    form.graph.reset(N);
+    for (int v = 1; v <= N; v++) {
+        form.toCanon[v] = cls[v];
+        form.fromCanon[cls[v]] = v;
+    }
+    for (int u = 1; u <= N; u++) {
+        for (uint64_t m = graph.row[u]; m; m &= m - 1) {
+            form.graph.row[form.toCanon[u]] |= 1ULL << form.toCanon[__builtin_ctzll(m)];
+        }
+    }
+    return form;
+}
+
+// Thread-safe memo of the best map seen per canonical graph. Templates are
+// stored in canonical labels with one byte per cell; a hit is one relabelling
+// pass over the template. Grids offered for a graph already cached only
+// replace the template when their side is smaller. Once `capacity` graphs
+// are cached, new ones are no longer added.
+class MapCache {
+public:
+    explicit MapCache(size_t capacity = 4096) : capacity_(capacity) {}
+
+    MapCache(const MapCache&) = delete;
+    MapCache& operator=(const MapCache&) = delete;
+
+    // Returns the cached map relabelled for the graph `form` came from, or an
+    // empty Grid on a miss.
+    Grid lookup(const CanonicalForm& form, GridArena* arena = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(form.graph);
+        if (it == entries_.end()) {
+            misses_++;
+            return Grid();
+        }
+        hits_++;
+        const Template& t = it->second;
+        Grid grid = Grid::allocate(t.rows, t.cols, 0, arena);
+        const uint8_t* cell = t.cells.data();
+        for (int r = 0; r < t.rows; r++) {
+            int* out = grid.row(r);
+            for (int c = 0; c < t.cols; c++) out[c] = form.fromCanon[*cell++];
+        }
+        return grid;
+    }
+
+    // `grid` must be a valid map of the graph `form` came from.
+    void store(const CanonicalForm& form, const Grid& grid) {
+        Template t;
+        t.rows = grid.rows();
+        t.cols = grid.cols();
+        t.cells.reserve((size_t)t.rows * t.cols);
+        for (int r = 0; r < t.rows; r++) {
+            const int* row = grid.row(r);
+            for (int c = 0; c < t.cols; c++) t.cells.push_back((uint8_t)form.toCanon[row[c]]);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        insert(form.graph, std::move(t));
+    }
+
+    // Persisted form, one graph per line:
+    //   n row[1] .. row[n] rows cols cell ...
+    // rows of the canonical graph in hex, cells in canonical labels. Returns
+    // false if the file cannot be written.
+    bool save(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "worldmap-cache 1\n";
+        for (const auto& entry : entries_) {
+            const EdgeMatrix& g = entry.first;
+            const Template& t = entry.second;
+            out << g.n << std::hex;
+            for (int u = 1; u <= g.n; u++) out << ' ' << g.row[u];
+            out << std::dec << ' ' << t.rows << ' ' << t.cols;
+            for (uint8_t cell : t.cells) out << ' ' << (int)cell;
+            out << '\n';
+        }
+        return (bool)out;
+    }
+
+    // Merges the entries of a file written by save(). Entries that do not
+    // parse or whose map fails checkMap() are skipped, so a stale or damaged
+    // file can only cost misses. Returns false if the file cannot be read.
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        std::string magic;
+        int version = 0;
+        if (!(in >> magic >> version) || magic != "worldmap-cache" || version != 1) return false;
+
+        EdgeMatrix g;
+        while (in >> g.n) {
+            if (g.n < 1 || g.n > EdgeMatrix::MAX_NODES) break;
+            uint64_t rows[EdgeMatrix::MAX_NODES + 1] = {};
+            in >> std::hex;
+            for (int u = 1; u <= g.n; u++) in >> rows[u];
+            in >> std::dec;
+            Template t;
+            if (!(in >> t.rows >> t.cols) || t.rows < 1 || t.cols < 1 || t.rows > 240 || t.cols > 240) break;
+            Grid grid(t.rows, t.cols);
+            for (int r = 0; r < t.rows; r++) {
+                for (int c = 0; c < t.cols; c++) in >> grid.at(r, c);
+            }
+            if (!in) break;
+
+            g.reset(g.n);
+            std::copy(rows + 1, rows + g.n + 1, g.row + 1);
+            if (!checkMap(grid, g).ok()) continue;
+            t.cells.reserve((size_t)t.rows * t.cols);
+            for (int r = 0; r < t.rows; r++) {
+                for (int c = 0; c < t.cols; c++) t.cells.push_back((uint8_t)grid.at(r, c));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            insert(g, std::move(t));
+        }
+        return true;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+    long long hits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hits_;
+    }
+    long long misses() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return misses_;
+    }
+
+private:
+    struct Template {
+        int rows = 0, cols = 0;
+        std::vector<uint8_t> cells;  // row-major, canonical labels
+    };
+
+    struct KeyHash {
+        size_t operator()(const EdgeMatrix& g) const {
+            uint64_t h = 1469598103934665603ULL ^ (uint64_t)g.n;
+            for (int u = 1; u <= g.n; u++) h = (h ^ g.row[u]) * 1099511628211ULL;
+            return (size_t)h;
+        }
+    };
+
+    struct KeyEqual {
+        bool operator()(const EdgeMatrix& a, const EdgeMatrix& b) const {
+            return a.n == b.n && std::equal(a.row + 1, a.row + a.n + 1, b.row + 1);
+        }
+    };
+
+    void insert(const EdgeMatrix& key, Template t) {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            if (entries_.size() < capacity_) entries_.emplace(key, std::move(t));
+        } else if (std::max(t.rows, t.cols) < std::max(it->second.rows, it->second.cols)) {
+            it->second = std::move(t);
+        }
+    }
+
+    size_t capacity_;
+    std::unordered_map<EdgeMatrix, Template, KeyHash, KeyEqual> entries_;
+    long long hits_ = 0, misses_ = 0;
+    mutable std::mutex mutex_;
+};
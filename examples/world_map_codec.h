@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_validate.h"
+
+// Compact serialised map. Colours are <= 40 and sides <= 240, so every field
+// fits a byte:
+//
+//   offset  size  field
+//   0       2     magic "WM"
+//   2       1     format version (1)
+//   3       1     N
+//   4       1     rows
+//   5       1     cols
+//   6       4     FNV-1a of bytes 3..5 and the payload, little-endian
+//   10      ...   payload: per row, (colour, run) byte pairs whose runs sum
+//                 to cols
+//
+// Star and chain layouts are a few runs per row, so a map costs O(K) bytes
+// instead of 4 K^2.
+const int MAP_HEADER_BYTES = 10;
+
+inline uint32_t mapChecksum(const uint8_t* bytes, size_t size) {
+    uint32_t h = 2166136261u;
+    auto mix = [&h](uint8_t b) { h = (h ^ b) * 16777619u; };
+    for (int i = 3; i < 6; i++) mix(bytes[i]);
+    for (size_t i = MAP_HEADER_BYTES; i < size; i++) mix(bytes[i]);
+    return h;
+}
+
+// Appends the encoding of `grid` (side <= 240, colours 1..N) to `out`.
+inline void encodeMap(const Grid& grid, int N, std::vector<uint8_t>& out) {
+    size_t start = out.size();
+    out.insert(out.end(), {'W', 'M', 1, (uint8_t)N, (uint8_t)grid.rows(), (uint8_t)grid.cols(), 0, 0, 0, 0});
+    for (int r = 0; r < grid.rows(); r++) {
+        const int* row = grid.row(r);
+        for (int c = 0; c < grid.cols();) {
+            int run = 1;
+            while (c + run < grid.cols() && row[c + run] == row[c]) run++;
+            out.push_back((uint8_t)row[c]);
+            out.push_back((uint8_t)run);
+            c += run;
+        }
+    }
+    uint32_t h = mapChecksum(out.data() + start, out.size() - start);
+    for (int i = 0; i < 4; i++) out[start + 6 + i] = (uint8_t)(h >> (8 * i));
+}
+
+inline std::vector<uint8_t> encodeMap(const Grid& grid, int N) {
+    std::vector<uint8_t> out;
+    encodeMap(grid, N, out);
+    return out;
+}
+
+// Header fields of an encoded map; `ok` is false for a truncated buffer, a
+// bad magic/version or a checksum mismatch.
+struct MapHeader {
+    bool ok = false;
+    int n = 0, rows = 0, cols = 0;
+};
+
+inline MapHeader readMapHeader(std::span<const uint8_t> bytes) {
+    MapHeader h;
+    if (bytes.size() < (size_t)MAP_HEADER_BYTES || bytes[0] != 'W' || bytes[1] != 'M' || bytes[2] != 1) return h;
+    uint32_t stored = 0;
+    for (int i = 0; i < 4; i++) stored |= (uint32_t)bytes[6 + i] << (8 * i);
+    if (stored != mapChecksum(bytes.data(), bytes.size())) return h;
+    h.n = bytes[3];
+    h.rows = bytes[4];
+    h.cols = bytes[5];
+    h.ok = true;
+    return h;
+}
+
+// Decodes into `out` (storage from `arena` if given). Returns false, leaving
+// `out` untouched, if the header is bad or the runs do not tile the grid.
+inline bool decodeMap(std::span<const uint8_t> bytes, Grid& out, GridArena* arena = nullptr) {
+    MapHeader h = readMapHeader(bytes);
+    if (!h.ok) return false;
+    Grid grid = Grid::allocate(h.rows, h.cols, 0, arena);
+    size_t p = MAP_HEADER_BYTES;
+    for (int r = 0; r < h.rows; r++) {
+        int* row = grid.row(r);
+        for (int c = 0; c < h.cols;) {
+            if (p + 2 > bytes.size()) return false;
+            int color = bytes[p], run = bytes[p + 1];
+            p += 2;
+            if (run == 0 || c + run > h.cols) return false;
+            std::fill(row + c, row + c + run, color);
+            c += run;
+        }
+    }
+    if (p != bytes.size()) return false;
+    out = std::move(grid);
+    return true;
+}
+
+// checkMap() on the encoded form, in O(runs) without expanding it: a row's
+// horizontal boundaries are between consecutive runs, and the vertical ones
+// are found by merging the run lists of neighbouring rows. A malformed
+// buffer is reported as MapError::Empty.
+inline MapCheck checkEncodedMap(std::span<const uint8_t> bytes, const EdgeMatrix& expected) {
+    MapCheck result;
+    MapHeader h = readMapHeader(bytes);
+    if (!h.ok || h.rows == 0 || h.cols == 0) {
+        result.error = MapError::Empty;
+        return result;
+    }
+    if (std::max(h.rows, h.cols) > 240) {
+        result.error = MapError::TooLarge;
+        return result;
+    }
+
+    int n = expected.n;
+    EdgeMatrix observed;
+    observed.reset(n);
+    uint64_t present = 0;
+    size_t prev = 0, prevEnd = 0;  // byte range of the previous row's runs
+    size_t p = MAP_HEADER_BYTES;
+    for (int r = 0; r < h.rows; r++) {
+        size_t begin = p;
+        int lastColor = 0;
+        for (int c = 0; c < h.cols;) {
+            if (p + 2 > bytes.size() || bytes[p + 1] == 0 || c + bytes[p + 1] > h.cols) {
+                result.error = MapError::Empty;
+                return result;
+            }
+            int color = bytes[p];
+            if ((unsigned)(color - 1) >= (unsigned)n) {
+                result.error = MapError::InvalidColor;
+                result.u = color;
+                result.r = r;
+                result.c = c;
+                return result;
+            }
+            present |= 1ULL << color;
+            if (c > 0 && color != lastColor) observed.add(color, lastColor);
+            lastColor = color;
+            c += bytes[p + 1];
+            p += 2;
+        }
+
+        // Walk both rows' runs; every overlap of two colours is a boundary.
+        if (r > 0) {
+            size_t a = prev, b = begin;
+            int endA = bytes[a + 1], endB = bytes[b + 1];
+            while (a < prevEnd && b < p) {
+                if (bytes[a] != bytes[b]) observed.add(bytes[a], bytes[b]);
+                bool nextA = endA <= endB, nextB = endB <= endA;
+                if (nextA && (a += 2) < prevEnd) endA += bytes[a + 1];
+                if (nextB && (b += 2) < p) endB += bytes[b + 1];
+            }
+        }
+        prev = begin;
+        prevEnd = p;
+    }
+    if (p != bytes.size()) {
+        result.error = MapError::Empty;
+        return result;
+    }
+    return compareAdjacency(observed, present, expected);
+}
@@ -0,0 +1,368 @@
+// Parallel fuzzer for the map engine.
+//
+//   g++ -std=c++20 -O2 world_map_fuzz.cpp world_map.cpp -o world_map_fuzz -lpthread
+//   ./world_map_fuzz [--cases=1000000] [--seconds=0] [--seed=1] [--threads=0]
+//                    [--budget-ms=20] [--slow-ms=250] [--minimize-side]
+//                    [--portfolio=THREADS] [--out=DIR] [--max-dumps=20] [--replay=SEED]
+//
+// Case i is graph seed + i from the world_map_gen.h families, picked
+// round-robin. Every generated graph is connected, so a map exists (the
+// diagonal construction is one). Each case is solved with build_map and
+// checked with checkMap.
+//
+// Seeds are shared between --threads workers (0 = one per hardware
+// thread). Each worker owns a range of seeds and takes them in blocks from
+// the front. A worker that runs dry steals the back half of the fullest
+// other range.
+//
+// A case fails when:
+//   - the map is invalid. It is then shrunk: nodes are dropped, then edges,
+//     as long as the graph stays connected and the map stays invalid.
+//   - the build takes longer than --slow-ms. Slow cases are not shrunk,
+//     because timing is too noisy to shrink against.
+//   - with --portfolio, build_map_portfolio on a pool of THREADS workers
+//     (one pool per fuzz worker) returns an invalid map, or one with a
+//     larger K than build_map's. The portfolio races every strategy the
+//     serial dispatch can pick, so it never loses on K when both searches
+//     stop at the same node count; both get a node-only budget for this,
+//     since time budgets run out unevenly under contention. Skipped with
+//     --minimize-side, as the portfolio does not minimise.
+//
+// Every failure is logged to stderr with its seed. The first --max-dumps
+// are written to DIR as wm-<seed>-<kind>.in in the grader's input format
+// (T, then N M and M edge lines). --replay reruns one seed verbosely.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "world_map.h"
+#include "world_map_gen.h"
+#include "world_map_report.h"
+#include "world_map_validate.h"
+
+using namespace std;
+
+struct FuzzOptions {
+    unsigned long long cases = 1000000;
+    double seconds = 0;  // 0: no time limit
+    unsigned long long seed = 1;
+    unsigned threads = 0;
+    double slowMs = 250;
+    string outDir;
+    int maxDumps = 20;
+    unsigned portfolioThreads = 0;  // 0: no portfolio check
+    MapOptions map;
+};
+
+// Seeds [next, end) of one worker. The owner takes blocks from the front;
+// thieves take the back half.
+struct SeedRange {
+    mutex m;
+    unsigned long long next = 0, end = 0;
+
+    bool take(unsigned long long block, unsigned long long& begin, unsigned long long& stop) {
+        lock_guard<mutex> lock(m);
+        if (next == end) return false;
+        begin = next;
+        stop = min(end, next + block);
+        next = stop;
+        return true;
+    }
+
+    unsigned long long remaining() {
+        lock_guard<mutex> lock(m);
+        return end - next;
+    }
+
+    bool stealInto(SeedRange& thief) {
+        unsigned long long begin, stop;
+        {
+            lock_guard<mutex> lock(m);
+            if (end - next < 2) return false;
+            begin = next + (end - next) / 2;
+            stop = end;
+            end = begin;
+        }
+        lock_guard<mutex> lock(thief.m);
+        thief.next = begin;
+        thief.end = stop;
+        return true;
+    }
+};
+
+static GraphCase makeCase(unsigned long long seed) {
+    static const vector<GraphFamily> families = graphFamilies();
+    mt19937 rng((uint32_t)(seed ^ (seed >> 32)) * 2654435761u + 1);
+    return families[seed % families.size()].make(rng);
+}
+
+static bool connected(const GraphCase& g) {
+    EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+    uint64_t reached = 1ULL << 1, frontier = reached;
+    while (frontier) {
+        uint64_t next = 0;
+        for (uint64_t f = frontier; f; f &= f - 1) next |= graph.row[__builtin_ctzll(f)];
+        frontier = next & ~reached;
+        reached |= next;
+    }
+    return __builtin_popcountll(reached) == g.N;
+}
+
+static bool invalidMap(const GraphCase& g, const MapOptions& options) {
+    static thread_local GridArena arena;
+    arena.reset();
+    EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+    Grid grid = build_map(graph, &arena, options);
+    return !checkMap(grid, graph).ok();
+}
+
+static GraphCase withoutNode(const GraphCase& g, int x) {
+    GraphCase h;
+    h.N = g.N - 1;
+    auto label = [x](int v) { return v < x ? v : v - 1; };
+    for (int i = 0; i < g.M; i++) {
+        if (g.A[i] != x && g.B[i] != x) h.add(label(g.A[i]), label(g.B[i]));
+    }
+    return h;
+}
+
+static GraphCase withoutEdge(const GraphCase& g, int e) {
+    GraphCase h;
+    h.N = g.N;
+    for (int i = 0; i < g.M; i++) {
+        if (i != e) h.add(g.A[i], g.B[i]);
+    }
+    return h;
+}
+
+// Greedy shrinking of a case with an invalid map. Every candidate stays
+// connected, so it still has a map and the failure is still the engine's.
+static GraphCase shrinkCase(GraphCase g, const MapOptions& options) {
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (int v = g.N; v >= 1 && g.N > 1; v--) {
+            GraphCase h = withoutNode(g, v);
+            if (connected(h) && invalidMap(h, options)) {
+                g = std::move(h);
+                progress = true;
+            }
+        }
+        for (int e = g.M - 1; e >= 0; e--) {
+            GraphCase h = withoutEdge(g, e);
+            if (connected(h) && invalidMap(h, options)) {
+                g = std::move(h);
+                progress = true;
+            }
+        }
+    }
+    return g;
+}
+
+class Fuzzer {
+public:
+    explicit Fuzzer(const FuzzOptions& options) : options_(options) {}
+
+    void run() {
+        unsigned threads = options_.threads ? options_.threads : max(1u, thread::hardware_concurrency());
+        ranges_ = vector<SeedRange>(threads);
+        for (unsigned w = 0; w < threads; w++) {
+            ranges_[w].next = options_.cases * w / threads;
+            ranges_[w].end = options_.cases * (w + 1) / threads;
+        }
+
+        start_ = Clock::now();
+        vector<thread> workers;
+        for (unsigned w = 0; w < threads; w++) workers.emplace_back([this, w] { work(w); });
+
+        unsigned long long reported = 0;
+        while (done_.load() < threads) {
+            this_thread::sleep_for(chrono::milliseconds(200));
+            double elapsed = secondsSince(start_);
+            if (options_.seconds > 0 && elapsed >= options_.seconds) stop_.store(true);
+            if (elapsed >= 5.0 * (reported + 1)) {
+                reported++;
+                progress(elapsed);
+            }
+        }
+        for (thread& t : workers) t.join();
+        if (cases_.load() != reportedCases_) progress(secondsSince(start_));
+    }
+
+    bool clean() const { return invalid_.load() == 0 && slow_.load() == 0 && portfolio_.load() == 0; }
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    static double secondsSince(Clock::time_point t) {
+        return chrono::duration<double>(Clock::now() - t).count();
+    }
+
+    void progress(double elapsed) {
+        unsigned long long n = cases_.load();
+        reportedCases_ = n;
+        fprintf(stderr, "fuzz: %llu cases in %.1fs (%.0f/s, %.2fM/h), %llu invalid, %llu slow, %llu portfolio\n", n,
+                elapsed, elapsed > 0 ? n / elapsed : 0.0, elapsed > 0 ? n / elapsed * 3600 / 1e6 : 0.0,
+                invalid_.load(), slow_.load(), portfolio_.load());
+    }
+
+    void work(unsigned w) {
+        const unsigned long long BLOCK = 64;
+        unsigned long long begin, end;
+        while (!stop_.load(memory_order_relaxed)) {
+            if (!ranges_[w].take(BLOCK, begin, end)) {
+                if (!steal(w)) break;
+                continue;
+            }
+            for (unsigned long long i = begin; i < end && !stop_.load(memory_order_relaxed); i++) {
+                runCase(options_.seed + i);
+                cases_.fetch_add(1, memory_order_relaxed);
+            }
+        }
+        done_.fetch_add(1);
+    }
+
+    // Refills worker w's range from the fullest other range.
+    bool steal(unsigned w) {
+        while (true) {
+            unsigned victim = w;
+            unsigned long long most = 1;
+            for (unsigned v = 0; v < ranges_.size(); v++) {
+                unsigned long long left = v == w ? 0 : ranges_[v].remaining();
+                if (left > most) most = left, victim = v;
+            }
+            if (victim == w) return false;
+            if (ranges_[victim].stealInto(ranges_[w])) return true;
+        }
+    }
+
+    void runCase(unsigned long long seed) {
+        static thread_local GridArena arena;
+        GraphCase g = makeCase(seed);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        arena.reset();
+        Clock::time_point t0 = Clock::now();
+        Grid grid = build_map(graph, &arena, options_.map);
+        double ms = secondsSince(t0) * 1000;
+        MapCheck check = checkMap(grid, graph);
+
+        if (!check.ok()) {
+            invalid_.fetch_add(1, memory_order_relaxed);
+            GraphCase small = shrinkCase(g, options_.map);
+            report(seed, "invalid", g, small);
+        } else if (ms > options_.slowMs) {
+            slow_.fetch_add(1, memory_order_relaxed);
+            report(seed, "slow", g, g);
+        }
+        if (options_.portfolioThreads && check.ok() && !options_.map.minimizeSide) checkPortfolio(seed, g, graph);
+    }
+
+    // The pool lives as long as the fuzz worker, so its shutdown runs once
+    // per worker at thread exit.
+    void checkPortfolio(unsigned long long seed, const GraphCase& g, const EdgeMatrix& graph) {
+        static thread_local unique_ptr<ThreadPool> pool;
+        static thread_local GridArena arena;
+        if (!pool) pool = make_unique<ThreadPool>(options_.portfolioThreads);
+        MapOptions serialOptions;
+        serialOptions.budget.maxNodes = 20000;
+        serialOptions.budget.maxSeconds = 1e9;
+        arena.reset();
+        Grid serial = build_map(graph, &arena, serialOptions);
+        PortfolioOptions portfolio;
+        portfolio.budget = serialOptions.budget;
+        Grid grid = build_map_portfolio(g.N, g.M, g.A, g.B, *pool, portfolio);
+        const char* kind = !checkMap(grid, graph).ok()   ? "portfolio-invalid"
+                           : grid.side() > serial.side() ? "portfolio-worse"
+                                                         : nullptr;
+        if (!kind) return;
+        portfolio_.fetch_add(1, memory_order_relaxed);
+        report(seed, kind, g, g);
+    }
+
+    void report(unsigned long long seed, const char* kind, const GraphCase& original, const GraphCase& dumped) {
+        lock_guard<mutex> lock(reportMutex_);
+        fprintf(stderr, "fuzz: seed %llu %s: N=%d M=%d", seed, kind, original.N, original.M);
+        if (dumped.N != original.N || dumped.M != original.M) fprintf(stderr, ", shrunk to N=%d M=%d", dumped.N, dumped.M);
+        if (options_.outDir.empty() || dumps_ >= options_.maxDumps) {
+            fprintf(stderr, "\n");
+            return;
+        }
+        dumps_++;
+        string path = options_.outDir + "/wm-" + to_string(seed) + "-" + kind + ".in";
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, ", cannot write %s\n", path.c_str());
+            return;
+        }
+        fprintf(f, "1\n%d %d\n", dumped.N, dumped.M);
+        for (int i = 0; i < dumped.M; i++) fprintf(f, "%d %d\n", dumped.A[i], dumped.B[i]);
+        fclose(f);
+        fprintf(stderr, ", wrote %s\n", path.c_str());
+    }
+
+    FuzzOptions options_;
+    vector<SeedRange> ranges_;
+    Clock::time_point start_;
+    atomic<unsigned long long> cases_{0}, invalid_{0}, slow_{0}, portfolio_{0};
+    atomic<unsigned> done_{0};
+    atomic<bool> stop_{false};
+    unsigned long long reportedCases_ = 0;  // main thread only
+    mutex reportMutex_;
+    int dumps_ = 0;
+};
+
+// One seed, with the graph, the map and the first violation.
+static int replay(unsigned long long seed, const MapOptions& options) {
+    GraphCase g = makeCase(seed);
+    EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+    Grid grid = build_map(graph, nullptr, options);
+    MapCheck check = checkMap(grid, graph);
+
+    BufferedWriter out;
+    out << "seed " << (long long)seed << ": N=" << g.N << " M=" << g.M << '\n';
+    for (int i = 0; i < g.M; i++) out << g.A[i] << ' ' << g.B[i] << '\n';
+    writeGrid(out, grid);
+    out << (check.ok() ? "valid" : "INVALID") << " (error " << (int)check.error << ", u=" << check.u
+        << " v=" << check.v << ")\n";
+    return check.ok() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    FuzzOptions options;
+    options.map.budget.maxSeconds = 0.02;
+    long long replaySeed = -1;
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (!strncmp(a, "--cases=", 8)) options.cases = strtoull(a + 8, nullptr, 10);
+        else if (!strncmp(a, "--seconds=", 10)) options.seconds = atof(a + 10);
+        else if (!strncmp(a, "--seed=", 7)) options.seed = strtoull(a + 7, nullptr, 10);
+        else if (!strncmp(a, "--threads=", 10)) options.threads = (unsigned)atoi(a + 10);
+        else if (!strncmp(a, "--budget-ms=", 12)) options.map.budget.maxSeconds = atof(a + 12) / 1000;
+        else if (!strncmp(a, "--slow-ms=", 10)) options.slowMs = atof(a + 10);
+        else if (!strcmp(a, "--minimize-side")) options.map.minimizeSide = true;
+        else if (!strncmp(a, "--portfolio=", 12)) options.portfolioThreads = (unsigned)atoi(a + 12);
+        else if (!strncmp(a, "--out=", 6)) options.outDir = a + 6;
+        else if (!strncmp(a, "--max-dumps=", 12)) options.maxDumps = atoi(a + 12);
+        else if (!strncmp(a, "--replay=", 9)) replaySeed = atoll(a + 9);
+        else {
+            fprintf(stderr,
+                    "usage: %s [--cases=N] [--seconds=T] [--seed=S] [--threads=T] [--budget-ms=B] [--slow-ms=L]\n"
+                    "          [--minimize-side] [--portfolio=THREADS] [--out=DIR] [--max-dumps=D] [--replay=SEED]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (replaySeed >= 0) return replay((unsigned long long)replaySeed, options.map);
+
+    Fuzzer fuzzer(options);
+    fuzzer.run();
+    return fuzzer.clean() ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_validate.h"
+
+// Seeded graph generators for benchmarks and fuzzing, one family per
+// subtask of ioi-tests/worldmap.md. Every generated graph is connected and
+// therefore has a map; edges are listed with A[i] < B[i] in generation order.
+
+struct GraphCase {
+    int N = 0, M = 0;
+    std::vector<int> A, B;
+
+    void add(int u, int v) {
+        A.push_back(std::min(u, v));
+        B.push_back(std::max(u, v));
+        M++;
+    }
+};
+
+// Subtask 1: the path 1 - 2 - ... - N.
+inline GraphCase genPath(int N) {
+    GraphCase g;
+    g.N = N;
+    for (int i = 1; i < N; i++) g.add(i, i + 1);
+    return g;
+}
+
+// Subtask 2: random recursive tree under a random labelling.
+inline GraphCase genTree(int N, std::mt19937& rng) {
+    std::vector<int> label(N + 1);
+    for (int v = 1; v <= N; v++) label[v] = v;
+    std::shuffle(label.begin() + 1, label.end(), rng);
+    GraphCase g;
+    g.N = N;
+    for (int v = 2; v <= N; v++) g.add(label[v], label[1 + rng() % (v - 1)]);
+    return g;
+}
+
+// Subtask 3: K_N.
+inline GraphCase genClique(int N) {
+    GraphCase g;
+    g.N = N;
+    for (int u = 1; u <= N; u++) {
+        for (int v = u + 1; v <= N; v++) g.add(u, v);
+    }
+    return g;
+}
+
+// Connected G(N, p): a random tree plus every other pair with probability p.
+inline GraphCase genRandom(int N, double p, std::mt19937& rng) {
+    GraphCase g = genTree(N, rng);
+    EdgeMatrix seen = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+    std::bernoulli_distribution coin(p);
+    for (int u = 1; u <= N; u++) {
+        for (int v = u + 1; v <= N; v++) {
+            if (!seen.has(u, v) && coin(rng)) g.add(u, v);
+        }
+    }
+    return g;
+}
+
+// Subtask 4: node 1 adjacent to everyone, other pairs with probability p.
+inline GraphCase genUniversal(int N, double p, std::mt19937& rng) {
+    GraphCase g;
+    g.N = N;
+    std::bernoulli_distribution coin(p);
+    for (int v = 2; v <= N; v++) g.add(1, v);
+    for (int u = 2; u <= N; u++) {
+        for (int v = u + 1; v <= N; v++) {
+            if (coin(rng)) g.add(u, v);
+        }
+    }
+    return g;
+}
+
+// Random K x K map: N seed cells grown into regions by random multi-source
+// flood fill, so every region is connected and every cell is coloured.
+inline Grid genRegionGrid(int N, int K, std::mt19937& rng) {
+    Grid grid(K, K, 0);
+    std::vector<int> frontier;
+    std::vector<int> cells(K * K);
+    for (int i = 0; i < K * K; i++) cells[i] = i;
+    std::shuffle(cells.begin(), cells.end(), rng);
+    for (int v = 1; v <= N; v++) {
+        grid.data()[cells[v - 1]] = v;
+        frontier.push_back(cells[v - 1]);
+    }
+    int dirs[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
+    while (!frontier.empty()) {
+        int i = rng() % frontier.size();
+        int cell = frontier[i];
+        int r = cell / K, c = cell % K;
+        int free[4], count = 0;
+        for (auto& d : dirs) {
+            int nr = r + d[0], nc = c + d[1];
+            if (nr >= 0 && nr < K && nc >= 0 && nc < K && grid.at(nr, nc) == 0) free[count++] = nr * K + nc;
+        }
+        if (count == 0) {
+            frontier[i] = frontier.back();
+            frontier.pop_back();
+            continue;
+        }
+        int next = free[rng() % count];
+        grid.data()[next] = grid.data()[cell];
+        frontier.push_back(next);
+    }
+    return grid;
+}
+
+// Adjacency of a map: the graph it is a valid map of.
+inline GraphCase graphOfGrid(const Grid& grid, int N) {
+    EdgeMatrix observed;
+    uint64_t present;
+    int r, c;
+    collectAdjacency(grid, N, observed, present, r, c);
+    GraphCase g;
+    g.N = N;
+    for (int u = 1; u <= N; u++) {
+        for (uint64_t m = observed.row[u] & (~0ULL << (u + 1)); m; m &= m - 1) g.add(u, __builtin_ctzll(m));
+    }
+    return g;
+}
+
+// Planar graph read off a random region map with N regions on a side
+// between ceil(sqrt(N)) and N.
+inline GraphCase genPlanar(int N, std::mt19937& rng) {
+    int lo = 1;
+    while (lo * lo < N) lo++;
+    int K = lo + (int)(rng() % (std::max(N, lo) - lo + 1));
+    return graphOfGrid(genRegionGrid(N, K, rng), N);
+}
+
+// A benchmark family: a name, the subtask it stresses and a generator for
+// its i-th graph.
+struct GraphFamily {
+    std::string name;
+    int subtask;
+    GraphCase (*make)(std::mt19937& rng);
+};
+
+inline int genSize(std::mt19937& rng, int lo, int hi) { return lo + (int)(rng() % (hi - lo + 1)); }
+
+inline std::vector<GraphFamily> graphFamilies() {
+    return {
+        {"path", 1, [](std::mt19937& rng) { return genPath(genSize(rng, 1, 40)); }},
+        {"tree", 2, [](std::mt19937& rng) { return genTree(genSize(rng, 1, 40), rng); }},
+        {"clique", 3, [](std::mt19937& rng) { return genClique(genSize(rng, 1, 40)); }},
+        {"universal", 4, [](std::mt19937& rng) {
+             return genUniversal(genSize(rng, 1, 40), std::uniform_real_distribution<double>(0, 0.5)(rng), rng);
+         }},
+        {"small", 5, [](std::mt19937& rng) {
+             return genRandom(genSize(rng, 1, 15), std::uniform_real_distribution<double>(0, 1)(rng), rng);
+         }},
+        {"planar", 6, [](std::mt19937& rng) { return genPlanar(genSize(rng, 1, 40), rng); }},
+        {"dense", 6, [](std::mt19937& rng) {
+             return genRandom(genSize(rng, 20, 40), std::uniform_real_distribution<double>(0.5, 1)(rng), rng);
+         }},
+    };
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for grid cells. Grids allocated from an arena borrow its
+// storage, so a batch driver can build thousands of maps and then reset()
+// once instead of freeing every grid. Blocks are kept across resets.
+class GridArena {
+public:
+    explicit GridArena(size_t blockCells = 240 * 240) : blockCells_(blockCells) {}
+
+    GridArena(const GridArena&) = delete;
+    GridArena& operator=(const GridArena&) = delete;
+
+    int* allocate(size_t count) {
+        while (block_ < blocks_.size() && offset_ + count > blocks_[block_].size) {
+            block_++;
+            offset_ = 0;
+        }
+        if (block_ == blocks_.size()) {
+            size_t size = std::max(count, blockCells_);
+            blocks_.push_back({std::make_unique<int[]>(size), size});
+            offset_ = 0;
+        }
+        int* cells = blocks_[block_].data.get() + offset_;
+        offset_ += count;
+        return cells;
+    }
+
+    // Invalidates every grid allocated from this arena.
+    void reset() {
+        block_ = 0;
+        offset_ = 0;
+    }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& b : blocks_) total += b.size;
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<int[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    size_t blockCells_;
+    size_t block_ = 0;
+    size_t offset_ = 0;
+};
+
+// Contiguous row-major grid of colours. Cell (r, c) lives at
+// data()[r * stride() + c]. Storage is either owned or borrowed from a
+// GridArena; grids are move-only so results are never deep-copied by accident.
+class Grid {
+public:
+    Grid() = default;
+
+    Grid(int rows, int cols, int fill = 0)
+        : owned_(static_cast<size_t>(rows) * cols, fill),
+          cells_(owned_.data()), rows_(rows), cols_(cols), stride_(cols) {}
+
+    Grid(int rows, int cols, int fill, GridArena& arena)
+        : cells_(arena.allocate(static_cast<size_t>(rows) * cols)),
+          rows_(rows), cols_(cols), stride_(cols) {
+        std::fill(cells_, cells_ + static_cast<size_t>(rows) * cols, fill);
+    }
+
+    // Owned storage when no arena is supplied.
+    static Grid allocate(int rows, int cols, int fill, GridArena* arena) {
+        return arena ? Grid(rows, cols, fill, *arena) : Grid(rows, cols, fill);
+    }
+
+    static Grid fromVectors(const std::vector<std::vector<int>>& rows, GridArena* arena = nullptr) {
+        int cols = rows.empty() ? 0 : static_cast<int>(rows[0].size());
+        Grid grid = allocate(static_cast<int>(rows.size()), cols, 0, arena);
+        for (int r = 0; r < grid.rows_; r++) {
+            std::copy(rows[r].begin(), rows[r].begin() + cols, grid.row(r));
+        }
+        return grid;
+    }
+
+    Grid(const Grid&) = delete;
+    Grid& operator=(const Grid&) = delete;
+
+    Grid(Grid&& other) noexcept { *this = std::move(other); }
+
+    Grid& operator=(Grid&& other) noexcept {
+        if (this != &other) {
+            bool ownsCells = other.cells_ == other.owned_.data();
+            owned_ = std::move(other.owned_);
+            cells_ = ownsCells ? owned_.data() : other.cells_;
+            rows_ = other.rows_;
+            cols_ = other.cols_;
+            stride_ = other.stride_;
+            other.cells_ = nullptr;
+            other.rows_ = other.cols_ = other.stride_ = 0;
+        }
+        return *this;
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int stride() const { return stride_; }
+    // The K reported to the grader: the larger of the two dimensions.
+    int side() const { return std::max(rows_, cols_); }
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+    int* data() { return cells_; }
+    const int* data() const { return cells_; }
+    int* row(int r) { return cells_ + static_cast<size_t>(r) * stride_; }
+    const int* row(int r) const { return cells_ + static_cast<size_t>(r) * stride_; }
+    int& at(int r, int c) { return row(r)[c]; }
+    int at(int r, int c) const { return row(r)[c]; }
+
+    // Adapter for the grader-facing create_map signature.
+    std::vector<std::vector<int>> toVectors() const {
+        std::vector<std::vector<int>> out(rows_);
+        for (int r = 0; r < rows_; r++) out[r].assign(row(r), row(r) + cols_);
+        return out;
+    }
+
+private:
+    std::vector<int> owned_;
+    int* cells_ = nullptr;
+    int rows_ = 0;
+    int cols_ = 0;
+    int stride_ = 0;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "world_map_grid.h"
+#include "world_map_search.h"
+#include "world_map_strategies.h"
+#include "world_map_validate.h"
+
+// What minimize() achieved, for K/N tracking (subtask 6 scores max K/N).
+struct SideReport {
+    int side = 0;        // K of the returned map
+    int lowerBound = 0;  // sideLowerBound() of the graph
+    int attempts = 0;    // MapSearch runs made
+    double ratio = 0;    // side / N
+};
+
+// Shrinks a known valid map to the smallest K the search can reach.
+//
+// Feasibility is monotone in K: duplicating the last row and column of a
+// valid map keeps it valid. So binary search over [sideLowerBound, K_known)
+// is sound, up to the search budget (a budget-limited failure is treated as
+// infeasible). Two scratch arenas are ping-ponged between attempts, and
+// they and the search state are kept across calls, so a long-lived optimizer
+// does no per-attempt allocation once warm. A budget already spent (or
+// cancelled) returns `known` as it is: the search only looks at the clock
+// every few thousand nodes, so it could otherwise still run on.
+class SideOptimizer {
+public:
+    Grid minimize(const EdgeMatrix& graph, Grid known, const SearchBudget& budget,
+                  GridArena* arena = nullptr, SideReport* report = nullptr) {
+        int lo = sideLowerBound(graph);
+        int hi = known.side();
+        int attempts = 0;
+        int steps = std::max(1, (int)std::ceil(std::log2((double)std::max(1, hi - lo + 1))) + 1);
+        SearchBudget slice = budget;
+        slice.maxNodes = std::max(1LL, budget.maxNodes / steps);
+        slice.maxSeconds = budget.maxSeconds / steps;
+
+        bool spent = budget.maxNodes <= 0 || budget.maxSeconds <= 0 ||
+                     (budget.cancel && budget.cancel->load(std::memory_order_relaxed));
+        int bestArena = -1;  // which scratch arena holds `best`, -1 = `known`
+        Grid best;
+        while (!spent && lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            int slot = bestArena == 0 ? 1 : 0;
+            scratch_[slot].reset();
+            Grid attempt(mid, mid, 0, scratch_[slot]);
+            attempts++;
+            if (search_.run(graph, attempt, slice)) {
+                best = std::move(attempt);
+                bestArena = slot;
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+
+        Grid result;
+        if (bestArena < 0) {
+            result = std::move(known);
+        } else {
+            result = Grid::allocate(best.rows(), best.cols(), 0, arena);
+            for (int r = 0; r < best.rows(); r++) {
+                std::copy(best.row(r), best.row(r) + best.cols(), result.row(r));
+            }
+        }
+
+        if (report) {
+            report->side = result.side();
+            report->lowerBound = sideLowerBound(graph);
+            report->attempts = attempts;
+            report->ratio = (double)result.side() / graph.n;
+        }
+        return result;
+    }
+
+private:
+    MapSearch search_;
+    GridArena scratch_[2];
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_validate.h"
+
+// Colour and edge counters shared by the placement states: how many cells
+// hold each colour, how many cell boundaries realise each required edge, and
+// how many boundaries are false adjacencies. The states report every
+// boundary they create or remove through addPair(), in O(1).
+class PlacementCounters {
+public:
+    int unrealizedEdges() const { return unrealized_; }
+    int falseAdjacencies() const { return falsePairs_; }
+    bool edgeRealized(int u, int v) const { return edgeCount_[u < v ? u : v][u < v ? v : u] > 0; }
+    // Neighbours of `u` whose edge to `u` has no boundary yet.
+    uint64_t unrealizedMask(int u) const { return unrealizedMask_[u]; }
+    uint64_t allColors() const { return allColors_; }
+    uint64_t presentColors() const { return present_; }
+    int colorCount(int v) const { return colorCount_[v]; }
+
+    bool complete() const {
+        return falsePairs_ == 0 && unrealized_ == 0 && present_ == allColors_;
+    }
+
+protected:
+    void resetCounters(const EdgeMatrix& graph) {
+        graph_ = &graph;
+        for (auto& row : edgeCount_) {
+            for (uint32_t& n : row) n = 0;
+        }
+        for (int& n : colorCount_) n = 0;
+        allColors_ = 0;
+        unrealized_ = 0;
+        for (int u = 0; u <= EdgeMatrix::MAX_NODES; u++) unrealizedMask_[u] = graph.row[u];
+        for (int u = 1; u <= graph.n; u++) {
+            allColors_ |= 1ULL << u;
+            unrealized_ += __builtin_popcountll(graph.row[u] & (~0ULL << (u + 1)));
+        }
+        present_ = 0;
+        falsePairs_ = 0;
+    }
+
+    void addColor(int v) {
+        if (colorCount_[v]++ == 0) present_ |= 1ULL << v;
+    }
+    void removeColor(int v) {
+        if (--colorCount_[v] == 0) present_ &= ~(1ULL << v);
+    }
+
+    void addPair(int u, int v, int delta) {
+        if (!graph_->has(u, v)) {
+            falsePairs_ += delta;
+            return;
+        }
+        uint32_t& n = edgeCount_[u < v ? u : v][u < v ? v : u];
+        if (delta > 0 && n++ == 0) {
+            unrealized_--;
+            unrealizedMask_[u] &= ~(1ULL << v);
+            unrealizedMask_[v] &= ~(1ULL << u);
+        }
+        if (delta < 0 && --n == 0) {
+            unrealized_++;
+            unrealizedMask_[u] |= 1ULL << v;
+            unrealizedMask_[v] |= 1ULL << u;
+        }
+    }
+
+    const EdgeMatrix* graph_ = nullptr;
+    uint32_t edgeCount_[EdgeMatrix::MAX_NODES + 1][EdgeMatrix::MAX_NODES + 1];
+    int colorCount_[EdgeMatrix::MAX_NODES + 1];
+    uint64_t unrealizedMask_[EdgeMatrix::MAX_NODES + 1];
+    uint64_t allColors_ = 0;
+    uint64_t present_ = 0;
+    int unrealized_ = 0;
+    int falsePairs_ = 0;
+};
+
+// Incremental bookkeeping for building a map cell by cell on a square grid.
+// Every place()/clear() updates, in O(1):
+//   - touching(cell): the colours on the four neighbours of each cell, from
+//     which safeColors(cell) derives which colours may still go there;
+//   - per-edge counters of how many cell boundaries realise each required
+//     edge, and how many boundaries are false adjacencies.
+// So an embedding that goes wrong is caught at the step that breaks it
+// instead of by a full Validator pass afterwards.
+class PlacementState : public PlacementCounters {
+public:
+    // Binds to `grid` (square, 0 = empty) and clears all counters. Scratch
+    // buffers are kept across resets so repeated attempts do not allocate.
+    void reset(const EdgeMatrix& graph, Grid& grid) {
+        K_ = grid.rows();
+        cells_ = grid.data();
+        int total = K_ * K_;
+        std::fill(cells_, cells_ + total, 0);
+        touching_.assign(total, 0);
+        occupied_.assign((total + 63) / 64, 0);
+        resetCounters(graph);
+    }
+
+    int side() const { return K_; }
+    int cellCount() const { return K_ * K_; }
+    int color(int cell) const { return cells_[cell]; }
+    bool isEmpty(int cell) const { return !((occupied_[cell >> 6] >> (cell & 63)) & 1); }
+    const std::vector<uint64_t>& occupancy() const { return occupied_; }
+
+    // Colours currently on the (up to four) neighbours of `cell`.
+    uint64_t touching(int cell) const { return touching_[cell]; }
+
+    // Colours that could occupy `cell` without creating a false adjacency.
+    uint64_t safeColors(int cell) const {
+        uint64_t safe = allColors_;
+        for (uint64_t t = touching_[cell]; t; t &= t - 1) {
+            int w = __builtin_ctzll(t);
+            safe &= graph_->row[w] | (1ULL << w);
+        }
+        return safe;
+    }
+
+    bool canPlace(int cell, int v) const {
+        return !(touching_[cell] & ~(graph_->row[v] | (1ULL << v)));
+    }
+
+    void place(int cell, int v) {
+        cells_[cell] = v;
+        occupied_[cell >> 6] |= 1ULL << (cell & 63);
+        addColor(v);
+        forEachNeighbour(cell, [&](int nb) {
+            touching_[nb] |= 1ULL << v;
+            int w = cells_[nb];
+            if (w != 0 && w != v) addPair(v, w, +1);
+        });
+    }
+
+    // Empties `cell` again; the exact inverse of place().
+    void clear(int cell) {
+        int v = cells_[cell];
+        cells_[cell] = 0;
+        occupied_[cell >> 6] &= ~(1ULL << (cell & 63));
+        removeColor(v);
+        forEachNeighbour(cell, [&](int nb) {
+            int w = cells_[nb];
+            if (w != 0 && w != v) addPair(v, w, -1);
+            uint64_t t = 0;
+            forEachNeighbour(nb, [&](int nn) { t |= 1ULL << cells_[nn]; });
+            touching_[nb] = t & ~1ULL;
+        });
+    }
+
+    template <class F>
+    void forEachNeighbour(int cell, F f) const {
+        int r = cell / K_;
+        int c = cell - r * K_;
+        if (r > 0) f(cell - K_);
+        if (r + 1 < K_) f(cell + K_);
+        if (c > 0) f(cell - 1);
+        if (c + 1 < K_) f(cell + 1);
+    }
+
+private:
+    int K_ = 0;
+    int* cells_ = nullptr;
+    std::vector<uint64_t> touching_;
+    std::vector<uint64_t> occupied_;
+};
+
+// PlacementState specialised on a compile-time bound of the side. Cells are
+// mirrored into fixed-size arrays with a two-cell border of empty (colour 0)
+// sentinels, so neighbour offsets are constants and no neighbour access, not
+// even of a neighbour's neighbour in clear(), needs a bounds check.
+template <int MaxSide>
+class FixedPlacementState : public PlacementCounters {
+public:
+    static const int STRIDE = MaxSide + 4;
+
+    void reset(const EdgeMatrix& graph, Grid& grid) {
+        K_ = grid.rows();
+        cells_ = grid.data();
+        std::fill(cells_, cells_ + K_ * K_, 0);
+        mirror_.fill(0);
+        touching_.fill(0);
+        for (int r = 0, cell = 0; r < K_; r++) {
+            for (int c = 0; c < K_; c++) at_[cell++] = (uint16_t)((r + 2) * STRIDE + c + 2);
+        }
+        resetCounters(graph);
+    }
+
+    int side() const { return K_; }
+    int color(int cell) const { return cells_[cell]; }
+    uint64_t touching(int cell) const { return touching_[at_[cell]]; }
+
+    uint64_t safeColors(int cell) const {
+        uint64_t safe = allColors_;
+        for (uint64_t t = touching_[at_[cell]]; t; t &= t - 1) {
+            int w = __builtin_ctzll(t);
+            safe &= graph_->row[w] | (1ULL << w);
+        }
+        return safe;
+    }
+
+    bool canPlace(int cell, int v) const {
+        return !(touching_[at_[cell]] & ~(graph_->row[v] | (1ULL << v)));
+    }
+
+    void place(int cell, int v) {
+        int b = at_[cell];
+        cells_[cell] = v;
+        mirror_[b] = (uint8_t)v;
+        addColor(v);
+        for (int nb : {b - STRIDE, b + STRIDE, b - 1, b + 1}) {
+            touching_[nb] |= 1ULL << v;
+            int w = mirror_[nb];
+            if (w != 0 && w != v) addPair(v, w, +1);
+        }
+    }
+
+    void clear(int cell) {
+        int b = at_[cell];
+        int v = mirror_[b];
+        cells_[cell] = 0;
+        mirror_[b] = 0;
+        removeColor(v);
+        for (int nb : {b - STRIDE, b + STRIDE, b - 1, b + 1}) {
+            int w = mirror_[nb];
+            if (w != 0 && w != v) addPair(v, w, -1);
+            touching_[nb] = ((1ULL << mirror_[nb - STRIDE]) | (1ULL << mirror_[nb + STRIDE]) |
+                             (1ULL << mirror_[nb - 1]) | (1ULL << mirror_[nb + 1])) & ~1ULL;
+        }
+    }
+
+private:
+    int K_ = 0;
+    int* cells_ = nullptr;
+    std::array<uint16_t, MaxSide * MaxSide> at_;  // row-major cell -> mirror index
+    std::array<uint8_t, STRIDE * STRIDE> mirror_;
+    std::array<uint64_t, STRIDE * STRIDE> touching_;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_registry.h"
+#include "world_map_search.h"
+#include "world_map_strategies.h"
+#include "world_map_validate.h"
+
+// Fixed-size pool of worker threads draining a FIFO of tasks.
+class ThreadPool {
+public:
+    // threads == 0: one worker per hardware thread.
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < threads; i++) workers_.emplace_back([this] { loop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        ready_.notify_one();
+    }
+
+    unsigned size() const { return (unsigned)workers_.size(); }
+
+private:
+    void loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_ = false;
+};
+
+struct PortfolioOptions {
+    int roots = 4;          // extra greedy BFS runs rooted at the highest-degree nodes
+    int randomRestarts = 8; // extra greedy BFS runs with randomised tie-breaking
+    bool search = true;     // race the backtracking search as well
+    SearchBudget budget;    // for the search entry; `cancel` is set by the portfolio
+};
+
+struct PortfolioResult {
+    Grid grid;             // empty if no strategy produced a valid map
+    std::string strategy;  // name of the winning strategy
+};
+
+// Runs every applicable strategy on `pool` and keeps the valid map with the
+// smallest K (ties go to the earlier entry, so the result is deterministic
+// unless cancellation cuts a run short). Once a map reaches sideLowerBound()
+// the remaining entries are cancelled: queued ones are skipped and the
+// search polls the flag.
+inline PortfolioResult solvePortfolio(const EdgeMatrix& graph, ThreadPool& pool,
+                                      const PortfolioOptions& options = PortfolioOptions()) {
+    struct Entry {
+        std::string name;
+        std::function<Grid()> run;
+    };
+
+    std::atomic<bool> cancel(false);
+    SearchBudget budget = options.budget;
+    budget.cancel = &cancel;
+
+    // Every registered strategy regardless of class (the inapplicable ones
+    // return an empty grid at once), the budgeted ones last.
+    std::vector<Entry> entries;
+    auto addStrategy = [&](const MapStrategy& s) {
+        entries.push_back({s.name, [&graph, &budget, build = s.build] { return build(graph, nullptr, budget); }});
+    };
+    for (const MapStrategy& s : mapStrategies()) {
+        if (!s.usesBudget) addStrategy(s);
+    }
+
+    std::vector<int> byDegree;
+    for (int v = 1; v <= graph.n; v++) byDegree.push_back(v);
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+                     [&](int a, int b) { return degree(graph, a) > degree(graph, b); });
+    for (int i = 0; i < options.roots && i < (int)byDegree.size(); i++) {
+        GreedyOptions opt;
+        opt.root = byDegree[i];
+        entries.push_back({"greedy-bfs root=" + std::to_string(opt.root),
+                           [&graph, opt] { return greedyBfsMap(graph, opt, nullptr); }});
+    }
+    for (int s = 1; s <= options.randomRestarts; s++) {
+        GreedyOptions opt;
+        opt.seed = 2654435761u * (uint32_t)s;
+        entries.push_back({"greedy-bfs seed=" + std::to_string(s),
+                           [&graph, opt] { return greedyBfsMap(graph, opt, nullptr); }});
+    }
+    for (const MapStrategy& s : mapStrategies()) {
+        if (s.usesBudget && options.search) addStrategy(s);
+    }
+
+    int target = sideLowerBound(graph);
+    std::mutex mutex;
+    std::condition_variable done;
+    int pending = (int)entries.size();
+    int bestIndex = -1;
+    PortfolioResult best;
+
+    for (int i = 0; i < (int)entries.size(); i++) {
+        pool.submit([&, i] {
+            if (!cancel.load(std::memory_order_relaxed)) {
+                Grid grid = graph.n == 1 ? Grid(1, 1, 1) : entries[i].run();
+                if (!grid.empty() && checkMap(grid, graph).ok()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    int side = grid.side();
+                    if (bestIndex < 0 || side < best.grid.side() ||
+                        (side == best.grid.side() && i < bestIndex)) {
+                        bestIndex = i;
+                        best.grid = std::move(grid);
+                        best.strategy = entries[i].name;
+                    }
+                    if (side <= target) cancel.store(true, std::memory_order_relaxed);
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    return best;
+}
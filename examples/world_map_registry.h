@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "world_map_grid.h"
+#include "world_map_search.h"
+#include "world_map_stats.h"
+#include "world_map_strategies.h"
+#include "world_map_validate.h"
+
+// Graph classes the engine dispatches on, one per subtask shape. A graph gets
+// the first class that fits, in this order.
+enum class GraphClass { Single, Path, Star, Tree, Clique, Dense, General };
+
+const int GRAPH_CLASSES = 7;
+
+inline const char* graphClassName(GraphClass cls) {
+    static const char* const names[GRAPH_CLASSES] = {"single", "path", "star", "tree", "clique", "dense", "general"};
+    return names[(int)cls];
+}
+
+struct GraphProfile {
+    GraphClass cls = GraphClass::General;
+    int edges = 0;
+    int maxDegree = 0;
+    bool connected = false;
+};
+
+// O(N + M) on the bitset rows: degrees by popcount, connectivity by a BFS
+// that takes a whole neighbour row per step. Disconnected graphs, which
+// have no valid map, are General.
+inline GraphProfile classifyGraph(const EdgeMatrix& graph) {
+    int N = graph.n;
+    GraphProfile p;
+    uint64_t all = 0;
+    int twice = 0;
+    for (int u = 1; u <= N; u++) {
+        int deg = degree(graph, u);
+        twice += deg;
+        p.maxDegree = std::max(p.maxDegree, deg);
+        all |= 1ULL << u;
+    }
+    p.edges = twice / 2;
+
+    uint64_t reached = 1ULL << 1, frontier = reached;
+    while (frontier) {
+        uint64_t next = 0;
+        for (uint64_t f = frontier; f; f &= f - 1) next |= graph.row[__builtin_ctzll(f)];
+        frontier = next & ~reached;
+        reached |= next;
+    }
+    p.connected = (reached & all) == all;
+
+    if (N == 1) p.cls = GraphClass::Single;
+    else if (p.connected && p.edges == N - 1)
+        p.cls = p.maxDegree <= 2 ? GraphClass::Path : p.maxDegree == N - 1 ? GraphClass::Star : GraphClass::Tree;
+    else if (p.edges == N * (N - 1) / 2) p.cls = GraphClass::Clique;
+    else if (isDense(graph)) p.cls = GraphClass::Dense;
+    return p;
+}
+
+inline uint32_t classBit(GraphClass cls) { return 1u << (int)cls; }
+
+// One layout strategy. `build` may return an empty grid (does not apply) or
+// an invalid one; only strategies with `usesBudget` look at the budget.
+struct MapStrategy {
+    const char* name;
+    uint32_t classes;  // classBit()s of the classes the engine tries it on
+    bool usesBudget;
+    Grid (*build)(const EdgeMatrix& graph, GridArena* arena, const SearchBudget& budget);
+
+    bool appliesTo(GraphClass cls) const { return classes & classBit(cls); }
+};
+
+// Dispatch table: for a graph of class C the engine tries the strategies
+// registered for C in this order and keeps the first valid map. Order within
+// a class is the measured one (world_map_bench --strategies): constructive
+// layouts first, the backtracking search only after the greedy BFS fails,
+// and the diagonal construction last for the General class because it
+// always validates but at up to twice the side.
+inline const MapStrategy MAP_STRATEGIES[] = {
+    {"chain", classBit(GraphClass::Path), false,
+     [](const EdgeMatrix& g, GridArena* arena, const SearchBudget&) {
+         WM_PHASE(layoutUs);
+         return chainMap(g, arena);
+     }},
+    // K <= N on every tree, well below N on bushy ones; ahead of the
+    // lattice on stars (K ~ 1.4 sqrt(N) against 2 sqrt(N)).
+    {"tree-strip", classBit(GraphClass::Star) | classBit(GraphClass::Tree), false,
+     [](const EdgeMatrix& g, GridArena* arena, const SearchBudget&) {
+         WM_PHASE(layoutUs);
+         return treeStripMap(g, arena);
+     }},
+    {"star", classBit(GraphClass::Star), false,
+     [](const EdgeMatrix& g, GridArena* arena, const SearchBudget&) {
+         WM_PHASE(layoutUs);
+         return starLatticeMap(g, arena);
+     }},
+    {"greedy-bfs", classBit(GraphClass::General), false,
+     [](const EdgeMatrix& g, GridArena* arena, const SearchBudget&) {
+         return greedyBfsMap(g, GreedyOptions(), arena);
+     }},
+    {"search", classBit(GraphClass::General), true,
+     [](const EdgeMatrix& g, GridArena*, const SearchBudget& budget) {
+         WM_PHASE(searchUs);
+         return searchSmallestMap(g, greedySide(g), budget);
+     }},
+    // Valid for every connected graph, so it backs up every class; cliques
+    // and dense graphs use nothing else.
+    {"diagonal", ~0u, false,
+     [](const EdgeMatrix& g, GridArena* arena, const SearchBudget&) {
+         WM_PHASE(layoutUs);
+         return diagonalMap(g, arena);
+     }},
+};
+
+inline std::span<const MapStrategy> mapStrategies() { return MAP_STRATEGIES; }
+
+// nullptr if no strategy has that name.
+inline const MapStrategy* findStrategy(std::string_view name) {
+    for (const MapStrategy& s : mapStrategies()) {
+        if (name == s.name) return &s;
+    }
+    return nullptr;
+}
+
+// Runs the strategies registered for the graph's class in order and returns
+// the first valid map. If none validates, the first non-empty result is
+// returned so the caller still has something to report on.
+inline Grid dispatchMap(const EdgeMatrix& graph, GraphClass cls, GridArena* arena, const SearchBudget& budget) {
+    Grid fallback;
+    for (const MapStrategy& s : mapStrategies()) {
+        if (!s.appliesTo(cls)) continue;
+        Grid grid = s.build(graph, arena, budget);
+        if (grid.empty()) continue;
+        if (checkMap(grid, graph).ok()) return grid;
+        if (fallback.empty()) fallback = std::move(grid);
+    }
+    return fallback;
+}
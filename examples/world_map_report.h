@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "world_map_grid.h"
+#include "world_map_stats.h"
+
+// Output buffer for the test drivers: text accumulates in memory and goes to
+// the stream in large writes, instead of one formatted << per grid cell.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(FILE* out = stdout, size_t limit = 1 << 16) : out_(out), limit_(limit) {
+        buffer_.reserve(limit + 256);
+    }
+    ~BufferedWriter() { flush(); }
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    BufferedWriter& operator<<(std::string_view s) {
+        buffer_.append(s);
+        if (buffer_.size() >= limit_) flush();
+        return *this;
+    }
+    BufferedWriter& operator<<(char c) {
+        buffer_.push_back(c);
+        if (buffer_.size() >= limit_) flush();
+        return *this;
+    }
+    BufferedWriter& operator<<(int v) {
+        char digits[16];
+        int n = std::snprintf(digits, sizeof digits, "%d", v);
+        return *this << std::string_view(digits, n);
+    }
+    BufferedWriter& operator<<(long long v) {
+        char digits[24];
+        int n = std::snprintf(digits, sizeof digits, "%lld", v);
+        return *this << std::string_view(digits, n);
+    }
+    BufferedWriter& operator<<(double v) {
+        char digits[32];
+        int n = std::snprintf(digits, sizeof digits, "%g", v);
+        return *this << std::string_view(digits, n);
+    }
+
+    void flush() {
+        if (!buffer_.empty()) std::fwrite(buffer_.data(), 1, buffer_.size(), out_);
+        buffer_.clear();
+        std::fflush(out_);
+    }
+
+private:
+    FILE* out_;
+    size_t limit_;
+    std::string buffer_;
+};
+
+// Every cell, space-separated, one grid row per line.
+inline void writeGrid(BufferedWriter& out, const Grid& grid) {
+    out << "Grid " << grid.rows() << 'x' << grid.cols() << ":\n";
+    for (int r = 0; r < grid.rows(); r++) {
+        const int* row = grid.row(r);
+        for (int c = 0; c < grid.cols(); c++) out << row[c] << ' ';
+        out << '\n';
+    }
+}
+
+// One line: "rle RxC" then each row as colour*run pairs (a run of one is
+// just the colour), rows separated by '/'.
+inline void writeGridRle(BufferedWriter& out, const Grid& grid) {
+    out << "rle " << grid.rows() << 'x' << grid.cols();
+    for (int r = 0; r < grid.rows(); r++) {
+        const int* row = grid.row(r);
+        out << (r ? " /" : "");
+        for (int c = 0; c < grid.cols();) {
+            int run = 1;
+            while (c + run < grid.cols() && row[c + run] == row[c]) run++;
+            out << ' ' << row[c];
+            if (run > 1) out << '*' << run;
+            c += run;
+        }
+    }
+    out << '\n';
+}
+
+// One line of key=value pairs, counters then phase times in microseconds.
+inline void writeStats(BufferedWriter& out, const MapStats& s) {
+    out << "stats: bfs_pops=" << s.bfsPops << " can_place_probes=" << s.canPlaceProbes
+        << " rejections=" << s.rejections << " fill_cells=" << s.fillCells << " search_nodes=" << s.searchNodes
+        << " adjacency_us=" << s.adjacencyUs << " classify_us=" << s.classifyUs
+        << " layout_us=" << s.layoutUs << " placement_us=" << s.placementUs << " fill_us=" << s.fillUs
+        << " search_us=" << s.searchUs << '\n';
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_placement.h"
+#include "world_map_stats.h"
+#include "world_map_validate.h"
+
+// Limits for one MapSearch::run(). A search stops at whichever is hit first,
+// or as soon as `cancel` (if set) becomes true.
+struct SearchBudget {
+    long long maxNodes = 2000000;
+    double maxSeconds = 0.5;
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+// Depth-first search for an exact map on a fixed K x K grid, assigning
+// colours cell by cell in row-major order on top of a placement state
+// (PlacementState or a large enough FixedPlacementState):
+//   - each level only offers safeColors(cell), so a placement can never
+//     create a false adjacency with the cells above and to the left;
+//   - backtracking is an O(1) clear() of the cell popped off the undo log;
+//   - colours are tried as: realises an unrealised edge with the up/left
+//     neighbour, not yet on the map, then everything else; within a tier
+//     higher-degree nodes go first;
+//   - a branch is cut when the unrealised-edge count exceeds the boundaries
+//     the remaining cells can still create, or the missing colours exceed
+//     the remaining cells.
+template <class State>
+class BasicMapSearch {
+public:
+    // Returns true with a valid map in `grid` (which must be square), or
+    // false once the space is exhausted or the budget runs out.
+    bool run(const EdgeMatrix& graph, Grid& grid, const SearchBudget& budget) {
+        int K = grid.rows();
+        int total = K * K;
+        state_.reset(graph, grid);
+        nodes_ = 0;
+        exhausted_ = false;
+
+        byDegree_.clear();
+        for (int v = 1; v <= graph.n; v++) byDegree_.push_back(v);
+        std::stable_sort(byDegree_.begin(), byDegree_.end(), [&](int a, int b) {
+            return __builtin_popcountll(graph.row[a]) > __builtin_popcountll(graph.row[b]);
+        });
+
+        // futureBoundaries_[d]: up/left boundaries still to be created once
+        // cells 0..d-1 are fixed.
+        futureBoundaries_.assign(total + 1, 0);
+        for (int d = total - 1; d >= 0; d--) {
+            futureBoundaries_[d] = futureBoundaries_[d + 1] + (d >= K) + (d % K != 0);
+        }
+        tried_.assign(total + 1, 0);
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(budget.maxSeconds));
+
+        int d = 0;
+        tried_[0] = 0;
+        while (true) {
+            if (d == total) {
+                if (state_.complete()) return true;
+                if (!backtrack(d)) break;
+                continue;
+            }
+            int v = pick(d, K);
+            if (v == 0) {
+                if (!backtrack(d)) break;
+                continue;
+            }
+            tried_[d] |= 1ULL << v;
+            state_.place(d, v);
+            if (++nodes_ >= budget.maxNodes) return false;
+            if ((nodes_ & 4095) == 0) {
+                if (std::chrono::steady_clock::now() > deadline) return false;
+                if (budget.cancel && budget.cancel->load(std::memory_order_relaxed)) return false;
+            }
+            if (prune(d + 1, total)) {
+                state_.clear(d);
+                continue;
+            }
+            tried_[++d] = 0;
+        }
+        exhausted_ = true;
+        return false;
+    }
+
+    long long nodesVisited() const { return nodes_; }
+    // True when the last run() proved no map exists at this K.
+    bool exhausted() const { return exhausted_; }
+
+private:
+    // Pops the undo log: steps back one level and empties that cell.
+    bool backtrack(int& d) {
+        if (d == 0) return false;
+        d--;
+        state_.clear(d);
+        return true;
+    }
+
+    bool prune(int placedCells, int total) const {
+        int remaining = total - placedCells;
+        if (state_.unrealizedEdges() > futureBoundaries_[placedCells]) return true;
+        uint64_t missing = state_.allColors() & ~state_.presentColors();
+        return __builtin_popcountll(missing) > remaining;
+    }
+
+    int pick(int d, int K) const {
+        uint64_t cands = state_.safeColors(d) & ~tried_[d];
+        if (!cands) return 0;
+        int up = d >= K ? state_.color(d - K) : 0;
+        int left = d % K ? state_.color(d - 1) : 0;
+        uint64_t tiers[3] = {
+            state_.unrealizedMask(up) | state_.unrealizedMask(left),
+            state_.allColors() & ~state_.presentColors(),
+            ~0ULL,
+        };
+        for (uint64_t tier : tiers) {
+            uint64_t m = cands & tier;
+            if (!m) continue;
+            for (int v : byDegree_) {
+                if ((m >> v) & 1) return v;
+            }
+        }
+        return 0;
+    }
+
+    State state_;
+    std::vector<int> byDegree_;
+    std::vector<int> futureBoundaries_;
+    std::vector<uint64_t> tried_;
+    long long nodes_ = 0;
+    bool exhausted_ = false;
+};
+
+// BasicMapSearch dispatching on the side: the smallest fixed-size placement
+// state that fits, the generic PlacementState beyond K = 64.
+class MapSearch {
+public:
+    bool run(const EdgeMatrix& graph, Grid& grid, const SearchBudget& budget) {
+        int K = grid.rows();
+        if (K <= 16) return runWith(small_, graph, grid, budget);
+        if (K <= 32) return runWith(medium_, graph, grid, budget);
+        if (K <= 64) return runWith(large_, graph, grid, budget);
+        return runWith(any_, graph, grid, budget);
+    }
+
+    long long nodesVisited() const { return nodes_; }
+    bool exhausted() const { return exhausted_; }
+
+private:
+    template <class Search>
+    bool runWith(Search& search, const EdgeMatrix& graph, Grid& grid, const SearchBudget& budget) {
+        bool found = search.run(graph, grid, budget);
+        nodes_ = search.nodesVisited();
+        exhausted_ = search.exhausted();
+        WM_COUNT_N(searchNodes, nodes_);
+        return found;
+    }
+
+    BasicMapSearch<FixedPlacementState<16>> small_;
+    BasicMapSearch<FixedPlacementState<32>> medium_;
+    BasicMapSearch<FixedPlacementState<64>> large_;
+    BasicMapSearch<PlacementState> any_;
+    long long nodes_ = 0;
+    bool exhausted_ = false;
+};
+
+// Exhaustive fallback for when the fast paths dead-end: tries increasing K,
+// smallest first up to maxK, splitting `budget` evenly across the sides
+// tried, and returns the first valid map (an empty Grid if none is found).
+// The search state is per thread and reused across calls.
+inline Grid searchSmallestMap(const EdgeMatrix& graph, int maxK, const SearchBudget& budget) {
+    int lo = std::max(1, (int)std::ceil(std::sqrt((double)graph.n)));
+    if (maxK < lo) return Grid();
+    SearchBudget slice = budget;
+    slice.maxNodes = std::max(1LL, budget.maxNodes / (maxK - lo + 1));
+    slice.maxSeconds = budget.maxSeconds / (maxK - lo + 1);
+
+    static thread_local MapSearch search;
+    for (int K = lo; K <= maxK; K++) {
+        if (budget.cancel && budget.cancel->load(std::memory_order_relaxed)) break;
+        Grid attempt(K, K, 0);
+        if (search.run(graph, attempt, slice)) return attempt;
+    }
+    return Grid();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_MAP_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define WORLD_MAP_NEON 1
+#endif
+
+// Row-scan kernel for adjacency extraction. For one row `cur` (and the row
+// below it, `next`, or nullptr on the last row) it sets
+//   bit j of right[j / 64]  iff cur[j] != cur[j + 1]
+//   bit j of down[j / 64]   iff cur[j] != next[j]
+// so callers only visit colour boundaries instead of every cell.
+// Both mask arrays must hold (cols + 63) / 64 words.
+const int ROW_MASK_WORDS = (240 + 63) / 64;
+
+typedef void (*RowScanFn)(const int* cur, const int* next, int cols, uint64_t* right, uint64_t* down);
+
+inline void clearRowMasks(int cols, uint64_t* right, uint64_t* down) {
+    for (int w = 0; w < (cols + 63) / 64; w++) right[w] = down[w] = 0;
+}
+
+inline void rowScanTail(const int* cur, const int* next, int from, int cols, uint64_t* right, uint64_t* down) {
+    for (int j = from; j < cols; j++) {
+        if (j + 1 < cols && cur[j] != cur[j + 1]) right[j >> 6] |= 1ULL << (j & 63);
+        if (next && cur[j] != next[j]) down[j >> 6] |= 1ULL << (j & 63);
+    }
+}
+
+inline void rowScanScalar(const int* cur, const int* next, int cols, uint64_t* right, uint64_t* down) {
+    clearRowMasks(cols, right, down);
+    rowScanTail(cur, next, 0, cols, right, down);
+}
+
+#if WORLD_MAP_X86
+// Eight lanes per step; the shifted load reads cur[j + 8], so the vector loop
+// stops one block early and the scalar tail finishes the row.
+__attribute__((target("avx2")))
+inline void rowScanAvx2(const int* cur, const int* next, int cols, uint64_t* right, uint64_t* down) {
+    clearRowMasks(cols, right, down);
+    int j = 0;
+    for (; j + 8 < cols; j += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(cur + j));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(cur + j + 1));
+        uint64_t ne = ~(uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))) & 0xFF;
+        right[j >> 6] |= ne << (j & 63);
+        if (next) {
+            __m256i c = _mm256_loadu_si256((const __m256i*)(next + j));
+            ne = ~(uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, c))) & 0xFF;
+            down[j >> 6] |= ne << (j & 63);
+        }
+    }
+    rowScanTail(cur, next, j, cols, right, down);
+}
+#endif
+
+#if WORLD_MAP_NEON
+inline uint64_t neonLaneMask(uint32x4_t eq) {
+    static const uint32_t weights[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(vmvnq_u32(eq), vld1q_u32(weights)));
+}
+
+// Four lanes per step, same shape as the AVX2 kernel.
+inline void rowScanNeon(const int* cur, const int* next, int cols, uint64_t* right, uint64_t* down) {
+    clearRowMasks(cols, right, down);
+    int j = 0;
+    for (; j + 4 < cols; j += 4) {
+        int32x4_t a = vld1q_s32(cur + j);
+        right[j >> 6] |= neonLaneMask(vceqq_s32(a, vld1q_s32(cur + j + 1))) << (j & 63);
+        if (next) down[j >> 6] |= neonLaneMask(vceqq_s32(a, vld1q_s32(next + j))) << (j & 63);
+    }
+    rowScanTail(cur, next, j, cols, right, down);
+}
+#endif
+
+// Picks the widest kernel the running CPU supports. AVX2 is probed at run
+// time on x86; NEON is part of the AArch64 baseline, so it is always taken.
+inline RowScanFn selectRowScan() {
+#if WORLD_MAP_X86
+    if (__builtin_cpu_supports("avx2")) return rowScanAvx2;
+#elif WORLD_MAP_NEON
+    return rowScanNeon;
+#endif
+    return rowScanScalar;
+}
+
+inline RowScanFn rowScan() {
+    static const RowScanFn fn = selectRowScan();
+    return fn;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+
+// Hot-path counters and phase timers for the map builders. Compile with
+// -DWORLD_MAP_STATS=1 to record them; by default WM_COUNT/WM_PHASE expand to
+// nothing and the builders carry no instrumentation cost.
+//
+// Stats are per thread and accumulate until cleared, so a driver measures
+// one call with mapStats().clear(), the call, then a read of mapStats().
+// Work a portfolio farms out to a pool is recorded on the pool's threads.
+#ifndef WORLD_MAP_STATS
+#define WORLD_MAP_STATS 0
+#endif
+
+struct MapStats {
+    // Counters
+    long long bfsPops = 0;         // nodes taken off the greedy BFS queue
+    long long canPlaceProbes = 0;  // candidate cells tested for a placement
+    long long rejections = 0;      // probes refused for a false adjacency
+    long long fillCells = 0;       // cells coloured by the fallback fill pass
+    long long searchNodes = 0;     // backtracking search nodes, including K minimisation
+
+    // Phase timers, microseconds
+    double adjacencyUs = 0;  // building adjacency from the edge list
+    double classifyUs = 0;   // graph classification
+    double layoutUs = 0;     // constructive layouts (chain, tree strip, star lattice, diagonal)
+    double placementUs = 0;  // general-case placement
+    double fillUs = 0;       // filling and trimming the leftover cells
+    double searchUs = 0;     // backtracking search and K minimisation
+
+    void clear() { *this = MapStats(); }
+};
+
+inline MapStats& mapStats() {
+    static thread_local MapStats stats;
+    return stats;
+}
+
+// Adds the lifetime of the object to a phase timer.
+class PhaseTimer {
+public:
+    explicit PhaseTimer(double& target) : target_(target), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        target_ += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    double& target_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define WM_CONCAT_(a, b) a##b
+#define WM_CONCAT(a, b) WM_CONCAT_(a, b)
+
+#if WORLD_MAP_STATS
+#define WM_COUNT(field) (mapStats().field++)
+#define WM_COUNT_N(field, n) (mapStats().field += (n))
+// Times the rest of the enclosing scope into mapStats().field.
+#define WM_PHASE(field) PhaseTimer WM_CONCAT(wmPhase_, __LINE__)(mapStats().field)
+#else
+#define WM_COUNT(field) ((void)0)
+#define WM_COUNT_N(field, n) ((void)0)
+#define WM_PHASE(field) ((void)0)
+#endif
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_placement.h"
+#include "world_map_stats.h"
+#include "world_map_validate.h"
+
+// Layout strategies, registered for dispatch in world_map_registry.h. Each
+// one takes the graph as an EdgeMatrix and returns an empty Grid when it
+// does not apply; none of them guarantees a valid map, so callers check the
+// result with checkMap().
+
+inline int edgeCount(const EdgeMatrix& graph) {
+    int twice = 0;
+    for (int u = 1; u <= graph.n; u++) twice += __builtin_popcountll(graph.row[u]);
+    return twice / 2;
+}
+
+inline int degree(const EdgeMatrix& graph, int u) { return __builtin_popcountll(graph.row[u]); }
+
+// Smallest K any map can have: every colour needs a cell (K^2 >= N) and every
+// edge a distinct boundary (2K(K-1) >= M).
+inline int sideLowerBound(const EdgeMatrix& graph) {
+    int M = edgeCount(graph);
+    int k = std::max(1, (int)std::ceil(std::sqrt((double)graph.n)));
+    while (2 * k * (k - 1) < M) k++;
+    return k;
+}
+
+// Path graph: one full row per chain node, top to bottom (K = N).
+inline Grid chainMap(const EdgeMatrix& graph, GridArena* arena) {
+    int N = graph.n;
+    int maxDeg = 0, deg1Count = 0, start = 0;
+    for (int i = 1; i <= N; i++) {
+        int deg = degree(graph, i);
+        maxDeg = std::max(maxDeg, deg);
+        if (deg == 1) {
+            deg1Count++;
+            if (!start) start = i;
+        }
+    }
+    if (N < 2 || edgeCount(graph) != N - 1 || deg1Count != 2 || maxDeg != 2) return Grid();
+
+    int K = std::min(N, 240);
+    Grid grid = Grid::allocate(K, K, 1, arena);
+    uint64_t visited = 0;
+    int curr = start;
+    for (int i = 0; i < K; i++) {
+        std::fill(grid.row(i), grid.row(i) + K, curr);
+        visited |= 1ULL << curr;
+        uint64_t next = graph.row[curr] & ~visited;
+        if (next) curr = __builtin_ctzll(next);
+    }
+    return grid;
+}
+
+// Star: leaves on the odd-row, odd-column cells of a background of the
+// center, so each leaf touches only the center: K = 2 ceil(sqrt(N - 1)).
+inline Grid starLatticeMap(const EdgeMatrix& graph, GridArena* arena) {
+    int N = graph.n;
+    int center = 0;
+    for (int i = 1; i <= N && !center; i++) {
+        if (degree(graph, i) == N - 1) center = i;
+    }
+    if (N < 2 || edgeCount(graph) != N - 1 || !center) return Grid();
+
+    int perSide = (int)std::ceil(std::sqrt((double)(N - 1)));
+    Grid grid = Grid::allocate(2 * perSide, 2 * perSide, center, arena);
+    int slot = 0;
+    for (int leaf = 1; leaf <= N; leaf++) {
+        if (leaf == center) continue;
+        grid.at(2 * (slot / perSide) + 1, 2 * (slot % perSide) + 1) = leaf;
+        slot++;
+    }
+    return grid;
+}
+
+// Dense graphs, where node degrees far exceed the four sides of a cell: a
+// layout is forced by construction instead of searched for.
+inline bool isDense(const EdgeMatrix& graph) {
+    int N = graph.n;
+    return N >= 4 && 4 * edgeCount(graph) >= N * (N - 1);
+}
+
+// Constructive layout valid for every connected graph, in O(N + K^2) with
+// no search. Colours are painted along anti-diagonals (cells with equal
+// r + c), whose cells only touch the diagonals just before and after:
+//   - the diagonals follow the Euler tour of a DFS tree, so neighbouring
+//     diagonals always differ by a tree edge;
+//   - a non-tree edge always joins a node to one of its DFS ancestors. At
+//     the first visit of a node u with such edges, u takes three diagonals
+//     and its ancestor neighbours are dropped into separate cells of the
+//     middle one, where they touch only u.
+// The middle diagonal is long enough: a node at depth d has at most d-1
+// such ancestors and is preceded by >= d diagonals and followed by
+// >= d+1 (the tour has to climb back to the root). With D diagonals,
+// K = ceil((D + 1) / 2) <= 2N; trees need no extra diagonals, so K = N.
+inline Grid diagonalMap(const EdgeMatrix& graph, GridArena* arena) {
+    const int MAX_NODES = EdgeMatrix::MAX_NODES;
+    int N = graph.n;
+    if (N == 1) return Grid::allocate(1, 1, 1, arena);
+
+    // Iterative DFS from node 1, recording the Euler tour.
+    int parent[MAX_NODES + 1] = {};
+    uint64_t ancestors[MAX_NODES + 1] = {};
+    int stack[MAX_NODES];
+    int tour[2 * MAX_NODES];
+    int top = 0, tourLen = 0;
+    uint64_t visited = 1ULL << 1;
+    stack[top++] = 1;
+    tour[tourLen++] = 1;
+    while (top) {
+        int u = stack[top - 1];
+        uint64_t next = graph.row[u] & ~visited;
+        if (next) {
+            int v = __builtin_ctzll(next);
+            visited |= 1ULL << v;
+            parent[v] = u;
+            ancestors[v] = ancestors[u] | (1ULL << u);
+            stack[top++] = v;
+            tour[tourLen++] = v;
+        } else if (--top) {
+            tour[tourLen++] = stack[top - 1];
+        }
+    }
+    uint64_t all = 0;
+    for (int v = 1; v <= N; v++) all |= 1ULL << v;
+    if (visited != all) return Grid();  // disconnected: no map exists
+
+    // Diagonal colours; special[d] != 0 marks the middle diagonal of a node
+    // carrying its back-edge neighbours.
+    int color[4 * MAX_NODES], special[4 * MAX_NODES];
+    int D = 0;
+    uint64_t seen = 0;
+    for (int t = 0; t < tourLen; t++) {
+        int u = tour[t];
+        uint64_t back = graph.row[u] & ancestors[u] & ~(1ULL << parent[u]);
+        if (!((seen >> u) & 1) && back) {
+            color[D] = u, special[D++] = 0;
+            color[D] = u, special[D++] = u;
+        }
+        color[D] = u, special[D++] = 0;
+        seen |= 1ULL << u;
+    }
+
+    int K = (D + 2) / 2;
+    Grid grid = Grid::allocate(K, K, 0, arena);
+    for (int d = 0; d <= 2 * K - 2; d++) {
+        int c = d < D ? color[d] : color[D - 1];
+        uint64_t back = 0;
+        if (d < D && special[d]) {
+            int u = special[d];
+            back = graph.row[u] & ancestors[u] & ~(1ULL << parent[u]);
+        }
+        for (int i = std::max(0, d - K + 1); i <= std::min(d, K - 1); i++) {
+            int v = c;
+            if (back) {
+                v = __builtin_ctzll(back);
+                back &= back - 1;
+            }
+            grid.at(i, d - i) = v;
+        }
+    }
+    return grid;
+}
+
+// Trees, with no placement search. Same anti-diagonal scheme as
+// diagonalMap, but the leaves leave the Euler tour: the tour runs over the
+// internal nodes only, and the leaves of u are dropped into cells of a
+// diagonal of u's own, sandwiched between two plain u diagonals
+// (u, u*, u), where each cell touches only u. One such diagonal costs two
+// diagonals and holds as many leaves as it is long, against two diagonals
+// per leaf in the plain tour, so bushy trees shrink well below K = N.
+//
+// Diagonals are longest mid-grid, so a node's leaves go at the visit of u
+// where its remaining leaves fit one diagonal, at the latest by its last
+// visit or the middle of the grid. That layout fits a side K iff its D
+// diagonals satisfy D <= 2K - 1; K is binary-searched over
+// [sideLowerBound, N]. K = N always fits (no grouping is worse than the
+// plain tour), so the result is valid with K <= N for every tree.
+//
+// One layout is linear in N; finding the smallest side takes O(log N) of
+// them, cheaper than the O(K^2) grid fill on all but the bushiest trees.
+// The search assumes that once a side fits every larger one does; where
+// that fails it may miss a smaller side, but it only ends on a side it saw
+// fit, or on K = N untested. That one is checked before the grid is
+// written: a tree it would not fit gets no grid, so dispatchMap moves on.
+inline Grid treeStripMap(const EdgeMatrix& graph, GridArena* arena) {
+    const int MAX_NODES = EdgeMatrix::MAX_NODES;
+    int N = graph.n;
+    if (N < 3 || edgeCount(graph) != N - 1) return Grid();
+
+    // Root at the highest-degree node: its visits span the whole tour.
+    int root = 1;
+    for (int v = 2; v <= N; v++) {
+        if (degree(graph, v) > degree(graph, root)) root = v;
+    }
+    if (degree(graph, root) < 2) return Grid();
+
+    // DFS over the internal nodes, collecting each node's leaves.
+    uint64_t leaves = 0;
+    for (int v = 1; v <= N; v++) {
+        if (v != root && degree(graph, v) == 1) leaves |= 1ULL << v;
+    }
+    uint64_t leavesOf[MAX_NODES + 1] = {};
+    int stack[MAX_NODES];
+    int tour[2 * MAX_NODES];
+    int lastVisit[MAX_NODES + 1] = {};
+    int top = 0, tourLen = 0;
+    uint64_t visited = (1ULL << root) | leaves;
+    stack[top++] = root;
+    tour[tourLen++] = root;
+    while (top) {
+        int u = stack[top - 1];
+        uint64_t next = graph.row[u] & ~visited;
+        if (next) {
+            int v = __builtin_ctzll(next);
+            visited |= 1ULL << v;
+            stack[top++] = v;
+            tour[tourLen++] = v;
+        } else if (--top) {
+            tour[tourLen++] = stack[top - 1];
+        }
+    }
+    uint64_t all = 0;
+    for (int v = 1; v <= N; v++) all |= 1ULL << v;
+    uint64_t internal = 0;
+    for (int t = 0; t < tourLen; t++) internal |= 1ULL << tour[t];
+    if ((internal | leaves) != all) return Grid();  // disconnected
+    for (int v = 1; v <= N; v++) {
+        if (!((leaves >> v) & 1)) continue;
+        int u = __builtin_ctzll(graph.row[v]);
+        if (!((internal >> u) & 1)) return Grid();
+        leavesOf[u] |= 1ULL << v;
+    }
+    for (int t = 0; t < tourLen; t++) lastVisit[tour[t]] = t;
+
+    // Lays the tour out for side K: color[d] per diagonal, owner[d] = u on
+    // the leaf diagonals of u. Returns the diagonal count, or 0 if it does
+    // not fit.
+    int color[4 * MAX_NODES], owner[4 * MAX_NODES];
+    auto layout = [&](int K) {
+        auto length = [K](int d) { return d <= 2 * K - 2 ? std::min(d + 1, 2 * K - 1 - d) : 0; };
+        int left[MAX_NODES + 1];
+        for (int v = 1; v <= N; v++) left[v] = __builtin_popcountll(leavesOf[v]);
+        int D = 0;
+        for (int t = 0; t < tourLen; t++) {
+            int u = tour[t];
+            color[D] = u, owner[D++] = 0;
+            bool defer = t != lastVisit[u] && D < K - 1 && length(D) < left[u];
+            while (left[u] && !defer) {
+                if (!length(D)) return 0;
+                left[u] -= std::min(left[u], length(D));
+                color[D] = u, owner[D++] = u;
+                color[D] = u, owner[D++] = 0;
+            }
+        }
+        return D <= 2 * K - 1 ? D : 0;
+    };
+
+    int lo = std::max(2, sideLowerBound(graph)), hi = N;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (layout(mid)) hi = mid;
+        else lo = mid + 1;
+    }
+    int K = lo;
+    int D = layout(K);
+    if (!D) return Grid();
+
+    Grid grid = Grid::allocate(K, K, 0, arena);
+    for (int d = 0; d <= 2 * K - 2; d++) {
+        int c = d < D ? color[d] : color[D - 1];
+        uint64_t* drop = d < D && owner[d] ? &leavesOf[owner[d]] : nullptr;
+        for (int i = std::max(0, d - K + 1); i <= std::min(d, K - 1); i++) {
+            int v = c;
+            if (drop && *drop) {
+                v = __builtin_ctzll(*drop);
+                *drop &= *drop - 1;
+            }
+            grid.at(i, d - i) = v;
+        }
+    }
+    return grid;
+}
+
+// Side greedyBfsMap lays the graph out on, and the largest the search
+// fallback tries: N + ceil(sqrt(2M)), capped at 240.
+inline int greedySide(const EdgeMatrix& graph) {
+    int M = edgeCount(graph);
+    return std::min(std::max(2, graph.n + (int)std::ceil(std::sqrt(2.0 * M))), 240);
+}
+
+// Knobs for greedyBfsMap. The defaults reproduce the original worldmap.cpp
+// pass: components started in node order, neighbours and directions tried
+// in a fixed order.
+struct GreedyOptions {
+    int root = 0;        // node to start the first BFS from (0 = node 1)
+    uint32_t seed = 0;   // non-zero: randomised tie-breaking between directions
+};
+
+// General graph: BFS placing every node next to an already placed neighbour
+// without creating false adjacencies, then filling the leftover cells with
+// safe colours (node 1 where possible), on a greedySide() grid.
+inline Grid greedyBfsMap(const EdgeMatrix& graph, const GreedyOptions& options, GridArena* arena) {
+    const int MAX_NODES = EdgeMatrix::MAX_NODES;
+    const uint64_t* adj = graph.row;
+    int N = graph.n;
+    int K = greedySide(graph);
+
+    // Flat row-major K*K cell array; 0 = empty.
+    Grid grid = Grid::allocate(K, K, 0, arena);
+    // Per-thread so its buffers are reused from one call to the next.
+    static thread_local PlacementState state;
+    state.reset(graph, grid);
+
+    // Cell of each placed node. A node is placed once, when the BFS first
+    // reaches it, so one cell per node is all there is to record.
+    int position[MAX_NODES + 1];
+    uint64_t placed = 0;
+
+    // Every node is enqueued exactly once, when it is first placed.
+    int q[MAX_NODES];
+    int qHead = 0, qTail = 0;
+
+    int dirs[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
+    uint32_t rng = options.seed;
+
+    auto claim = [&](int cell, int v) {
+        state.place(cell, v);
+        position[v] = cell;
+        placed |= 1ULL << v;
+        q[qTail++] = v;
+    };
+
+    // Handle all components, not just the root's
+    for (int k = options.root ? 0 : 1; k <= N; k++) {
+        int start_node = k == 0 ? options.root : k;
+        if (placed & (1ULL << start_node)) continue;
+        WM_PHASE(placementUs);
+
+        // Start BFS from this component
+        int start_r = K/2 + (start_node - 1) / 10;  // Spread components
+        int start_c = K/2 + (start_node - 1) % 10;
+        if (start_r >= K) start_r = K - 1;
+        if (start_c >= K) start_c = K - 1;
+
+        // Only another component can have taken the start cell, and a
+        // disconnected graph has no map; leave the rest of it out.
+        if (!state.isEmpty(start_r * K + start_c)) break;
+        claim(start_r * K + start_c, start_node);
+
+        while (qHead < qTail) {
+            int u = q[qHead++];
+            WM_COUNT(bfsPops);
+
+            for (uint64_t todo = adj[u] & ~placed; todo; todo &= todo - 1) {
+                int v = __builtin_ctzll(todo);
+
+                int order[4] = {0, 1, 2, 3};
+                if (rng) {
+                    for (int i = 3; i > 0; i--) {
+                        rng ^= rng << 13;
+                        rng ^= rng >> 17;
+                        rng ^= rng << 5;
+                        std::swap(order[i], order[rng % (i + 1)]);
+                    }
+                }
+
+                int ur = position[u] / K;
+                int uc = position[u] % K;
+                for (int o : order) {
+                    int nr = ur + dirs[o][0];
+                    int nc = uc + dirs[o][1];
+
+                    if (nr < 0 || nr >= K || nc < 0 || nc >= K) continue;
+                    int cell = nr * K + nc;
+                    if (!state.isEmpty(cell)) continue;
+
+                    // Placing v here must not create false adjacencies
+                    WM_COUNT(canPlaceProbes);
+                    if (state.canPlace(cell, v)) {
+                        claim(cell, v);
+                        break;
+                    }
+                    WM_COUNT(rejections);
+                }
+            }
+        }
+    }
+
+    // Fill remaining empty cells, preferring node 1 but only with a colour
+    // that keeps every boundary legal. A cell with no safe colour is where the
+    // embedding fails: it takes node 1 anyway, and falseAdjacencies() turns
+    // nonzero at that step.
+    WM_PHASE(fillUs);
+    const std::vector<uint64_t>& occupied = state.occupancy();
+    for (int w = 0; w < (int)occupied.size(); w++) {
+        for (uint64_t empty = ~occupied[w]; empty; empty &= empty - 1) {
+            int cell = w * 64 + __builtin_ctzll(empty);
+            if (cell >= K * K) break;
+            uint64_t safe = state.safeColors(cell);
+            int v = (safe & 2) || !safe ? 1 : __builtin_ctzll(safe);
+            state.place(cell, v);
+            WM_COUNT(fillCells);
+        }
+    }
+
+    return grid;
+}
@@ -1,140 +1,799 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <vector>
+#include <random>
 #include <set>
+#include <vector>
 #include <cassert>
-#include "world_map.cpp"
+#include <string>
+#include "world_map.h"
+#include "world_map_codec.h"
+#include "world_map_gen.h"
+#include "world_map_report.h"
+#include "world_map_validate.h"
 
 using namespace std;
 
+// Verbose prints every grid and error the way the harness always has.
+// Quiet prints one summary line per test, plus an RLE dump of the grid when
+// the test fails or dumps are requested.
+enum class OutputMode { Verbose, Quiet };
+
 class Validator {
 private:
     int N, M;
-    vector<set<int>> adj;
+    EdgeMatrix expected;
     int K;
-    vector<vector<int>> grid;
-
-    void printGrid() {
-        int rows = grid.size();
-        int cols = grid.empty() ? 0 : grid[0].size();
-        cout << "Grid " << rows << "x" << cols << ":\n";
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                cout << grid[i][j] << " ";
-            }
-            cout << "\n";
+    // Results are built straight into the arena; reset once per test.
+    GridArena arena;
+    Grid grid;
+    BufferedWriter& out;
+    OutputMode mode;
+    bool dumpAll;
+
+    string describe(const MapCheck& check) {
+        switch (check.error) {
+        case MapError::None:
+            return "";
+        case MapError::Empty:
+            return "Grid is empty";
+        case MapError::TooLarge:
+            return "K = " + to_string(K) + " exceeds 240";
+        case MapError::InvalidColor:
+            return "Invalid country " + to_string(check.u) + " at (" + to_string(check.r) + "," +
+                   to_string(check.c) + ")";
+        case MapError::MissingColor:
+            return "Only " + to_string(check.present) + " countries present, expected " + to_string(N);
+        case MapError::MissingEdge:
+            return "Edge (" + to_string(check.u) + "," + to_string(check.v) + ") not in grid";
+        case MapError::FalseAdjacency:
+            return "Grid adjacency (" + to_string(check.u) + "," + to_string(check.v) + ") not in graph";
         }
+        return "";
     }
 
-    bool validate() {
-        int rows = grid.size();
-        if (rows == 0) {
-            cout << "ERROR: Grid is empty\n";
-            return false;
-        }
+public:
+    Validator(BufferedWriter& out, OutputMode mode = OutputMode::Verbose, bool dumpAll = false)
+        : out(out), mode(mode), dumpAll(dumpAll) {}
 
-        int cols = grid[0].size();
-        K = max(rows, cols);
+    bool test(int N, int M, const vector<int>& A, const vector<int>& B, const string& testName) {
+        this->N = N;
+        this->M = M;
+        expected = EdgeMatrix::fromEdges(N, M, A, B);
+
+        arena.reset();
+        mapStats().clear();
+        grid = build_map(N, M, A, B, &arena);
+        K = grid.side();
+        MapCheck check = checkMap(grid, expected);
+        bool valid = check.ok();
+
+        if (mode == OutputMode::Quiet) {
+            out << (valid ? "PASS " : "FAIL ") << testName << ": N=" << N << " M=" << M << " K=" << K;
+            if (valid) out << " K/N=" << (double)grid.rows() / N << '\n';
+            else out << " - " << describe(check) << '\n';
+            if (!valid || dumpAll) writeGridRle(out, grid);
+#if WORLD_MAP_STATS
+            writeStats(out, mapStats());
+#endif
+            return valid;
+        }
 
-        if (K > 240) {
-            cout << "ERROR: K = " << K << " exceeds 240\n";
-            return false;
+        out << "\n=== Test: " << testName << " ===\n";
+        out << "N=" << N << ", M=" << M << "\n";
+        writeGrid(out, grid);
+        if (valid) {
+            out << "PASS - K/N ratio: " << (double)grid.rows() / N << "\n";
+        } else {
+            out << "ERROR: " << describe(check) << "\n";
+            out << "FAIL\n";
         }
+        if (dumpAll) writeGridRle(out, grid);
+#if WORLD_MAP_STATS
+        writeStats(out, mapStats());
+#endif
 
-        // Check all countries appear
-        set<int> countries;
-        for (int i = 0; i < rows; i++) {
-            if (grid[i].size() != cols) {
-                cout << "ERROR: Grid rows have different lengths\n";
-                return false;
-            }
-            for (int j = 0; j < cols; j++) {
-                if (grid[i][j] < 1 || grid[i][j] > N) {
-                    cout << "ERROR: Invalid country " << grid[i][j] << " at (" << i << "," << j << ")\n";
-                    return false;
+        return valid;
+    }
+};
+
+// Seeded checks of library parts the example graphs above do not reach.
+// Each returns an empty string on success, else what went wrong.
+
+static string describe(const MapCheck& c) {
+    return "error " + to_string((int)c.error) + " u=" + to_string(c.u) + " v=" + to_string(c.v) + " at (" +
+           to_string(c.r) + "," + to_string(c.c) + ") present=" + to_string(c.present);
+}
+
+static bool sameCheck(const MapCheck& a, const MapCheck& b) {
+    return a.error == b.error && a.u == b.u && a.v == b.v && a.r == b.r && a.c == b.c && a.present == b.present;
+}
+
+// Maps of the generator families built with a small search budget.
+static Grid quickMap(const EdgeMatrix& graph, GridArena* arena = nullptr) {
+    MapOptions options;
+    options.budget.maxSeconds = 0.01;
+    return build_map(graph, arena, options);
+}
+
+// Encode, decode and the encoded-form validator on built maps and on copies
+// with one cell recoloured to 0..N+1 (so also out of range); then a flipped
+// bit anywhere must be rejected.
+static string codecRoundTrip() {
+    mt19937 rng(15);
+    vector<GraphFamily> families = graphFamilies();
+    for (int i = 0; i < 300; i++) {
+        GraphCase g = families[i % families.size()].make(rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        Grid grid = quickMap(graph);
+        string at = "case " + to_string(i);
+        for (int mutation = 0; mutation < 4; mutation++) {
+            if (mutation) grid.at(rng() % grid.rows(), rng() % grid.cols()) = (int)(rng() % (g.N + 2));
+            vector<uint8_t> bytes = encodeMap(grid, g.N);
+            MapHeader h = readMapHeader(bytes);
+            if (!h.ok || h.n != g.N || h.rows != grid.rows() || h.cols != grid.cols()) return at + ": bad header";
+            Grid decoded;
+            if (!decodeMap(bytes, decoded)) return at + ": decode failed";
+            for (int r = 0; r < grid.rows(); r++) {
+                for (int c = 0; c < grid.cols(); c++) {
+                    if (decoded.at(r, c) != grid.at(r, c)) return at + ": decoded cell differs";
                 }
-                countries.insert(grid[i][j]);
             }
+            MapCheck direct = checkMap(grid, graph), encoded = checkEncodedMap(bytes, graph);
+            if (!sameCheck(direct, encoded))
+                return at + ": checkMap " + describe(direct) + ", checkEncodedMap " + describe(encoded);
         }
+        vector<uint8_t> bytes = encodeMap(grid, g.N);
+        bytes[rng() % bytes.size()] ^= (uint8_t)(1 << rng() % 8);
+        Grid decoded;
+        if (readMapHeader(bytes).ok || decodeMap(bytes, decoded)) return at + ": corrupted encoding accepted";
+        bytes = encodeMap(grid, g.N);
+        bytes.pop_back();
+        if (decodeMap(bytes, decoded)) return at + ": truncated encoding accepted";
+    }
+    return "";
+}
 
-        if ((int)countries.size() != N) {
-            cout << "ERROR: Only " << countries.size() << " countries present, expected " << N << "\n";
-            return false;
-        }
+static GraphCase relabelled(const GraphCase& g, mt19937& rng) {
+    vector<int> label(g.N + 1);
+    for (int v = 1; v <= g.N; v++) label[v] = v;
+    shuffle(label.begin() + 1, label.end(), rng);
+    GraphCase h;
+    h.N = g.N;
+    for (int i = 0; i < g.M; i++) h.add(label[g.A[i]], label[g.B[i]]);
+    return h;
+}
+
+// Every family graph is solved into a cache, then solved again under a
+// random relabelling. Paths, stars and cliques canonicalise whatever the
+// labels, so those must hit; any hit must validate under the new labels.
+static string cacheRelabelled() {
+    mt19937 rng(10);
+    vector<GraphFamily> families = graphFamilies();
+    MapCache cache;
+    MapOptions options;
+    options.budget.maxSeconds = 0.01;
+    options.cache = &cache;
+    for (int i = 0; i < 200; i++) {
+        GraphCase g = families[i % families.size()].make(rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        if (!checkMap(build_map(graph, nullptr, options), graph).ok()) continue;
+        GraphCase h = relabelled(g, rng);
+        EdgeMatrix moved = EdgeMatrix::fromEdges(h.N, h.M, h.A, h.B);
+        long long hits = cache.hits();
+        MapCheck check = checkMap(build_map(moved, nullptr, options), moved);
+        bool hit = cache.hits() > hits;
+        GraphClass cls = classifyGraph(graph).cls;
+        bool mustHit = cls == GraphClass::Single || cls == GraphClass::Path || cls == GraphClass::Star ||
+                       cls == GraphClass::Clique;
+        string at = "case " + to_string(i) + " (" + graphClassName(cls) + ")";
+        if (mustHit && !hit) return at + ": relabelled graph missed the cache";
+        if (!check.ok()) return at + ": " + (hit ? "cached" : "solved") + " map invalid, " + describe(check);
+    }
+    return cache.hits() > 0 ? "" : "no hits at all";
+}
 
-        // Check adjacency constraints
-        set<pair<int,int>> gridAdj;
-        int dirs[4][2] = {{-1,0},{1,0},{0,-1},{0,1}};
+// save() then load() into a fresh cache gives back every entry, each still
+// a hit that validates; a damaged entry appended to the file is skipped.
+static string cacheSaveLoad() {
+    const string path = "world_map_test.cache";
+    mt19937 rng(11);
+    vector<GraphFamily> families = graphFamilies();
+    MapCache cache;
+    MapOptions options;
+    options.budget.maxSeconds = 0.01;
+    options.cache = &cache;
+    vector<EdgeMatrix> graphs;
+    for (int i = 0; i < 100; i++) {
+        GraphCase g = families[i % families.size()].make(rng);
+        graphs.push_back(EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B));
+        build_map(graphs.back(), nullptr, options);
+    }
+    if (!cache.save(path)) return "cannot write " + path;
+    {
+        // A 2-node graph whose "map" lacks node 2.
+        ofstream damaged(path, ios::app);
+        damaged << "2 4 2 1 1 1\n";
+    }
+    MapCache loaded;
+    bool read = loaded.load(path);
+    remove(path.c_str());
+    if (!read) return "cannot read " + path;
+    if (loaded.size() != cache.size())
+        return "loaded " + to_string(loaded.size()) + " entries, saved " + to_string(cache.size());
+    for (size_t i = 0; i < graphs.size(); i++) {
+        CanonicalForm form = canonicalize(graphs[i]);
+        Grid grid = loaded.lookup(form);
+        if (grid.empty()) return "graph " + to_string(i) + " missing after load";
+        MapCheck check = checkMap(grid, graphs[i]);
+        if (!check.ok()) return "graph " + to_string(i) + " loaded map invalid, " + describe(check);
+    }
+    return "";
+}
 
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                for (auto& d : dirs) {
-                    int ni = i + d[0];
-                    int nj = j + d[1];
-                    if (ni >= 0 && ni < rows && nj >= 0 && nj < cols) {
-                        int u = grid[i][j];
-                        int v = grid[ni][nj];
-                        if (u != v) {
-                            int a = min(u, v), b = max(u, v);
-                            gridAdj.insert({a, b});
-                        }
-                    }
-                }
+// checkMap as the harness first wrote it: every neighbour pair into a set,
+// then the edges looked up in it. Same diagnostics, same order.
+static MapCheck referenceCheck(const Grid& grid, const EdgeMatrix& expected) {
+    MapCheck result;
+    int n = expected.n;
+    if (grid.empty()) {
+        result.error = MapError::Empty;
+        return result;
+    }
+    if (grid.side() > 240) {
+        result.error = MapError::TooLarge;
+        return result;
+    }
+    set<int> colors;
+    for (int r = 0; r < grid.rows(); r++) {
+        for (int c = 0; c < grid.cols(); c++) {
+            int v = grid.at(r, c);
+            if (v < 1 || v > n) {
+                result.error = MapError::InvalidColor;
+                result.u = v;
+                result.r = r;
+                result.c = c;
+                return result;
+            }
+            colors.insert(v);
+        }
+    }
+    result.present = (int)colors.size();
+    if (result.present != n) {
+        result.error = MapError::MissingColor;
+        return result;
+    }
+    set<pair<int, int>> seen;
+    for (int r = 0; r < grid.rows(); r++) {
+        for (int c = 0; c < grid.cols(); c++) {
+            int v = grid.at(r, c);
+            if (c + 1 < grid.cols() && grid.at(r, c + 1) != v) seen.insert(minmax(v, grid.at(r, c + 1)));
+            if (r + 1 < grid.rows() && grid.at(r + 1, c) != v) seen.insert(minmax(v, grid.at(r + 1, c)));
+        }
+    }
+    for (int u = 1; u <= n; u++) {
+        for (int v = u + 1; v <= n; v++) {
+            if (expected.has(u, v) && !seen.count({u, v})) {
+                result.error = MapError::MissingEdge;
+                result.u = u;
+                result.v = v;
+                return result;
             }
         }
+    }
+    for (auto [u, v] : seen) {
+        if (!expected.has(u, v)) {
+            result.error = MapError::FalseAdjacency;
+            result.u = u;
+            result.v = v;
+            return result;
+        }
+    }
+    return result;
+}
 
-        // Check all graph edges are in grid adjacency
-        for (int u = 1; u <= N; u++) {
-            for (int v : adj[u]) {
-                if (u < v) {
-                    if (gridAdj.find({u, v}) == gridAdj.end()) {
-                        cout << "ERROR: Edge (" << u << "," << v << ") not in grid\n";
-                        return false;
-                    }
+// checkMap against referenceCheck on region maps cropped to random shapes,
+// and on sparse maps, so every validator path (both fixed sizes, the row
+// scan past 32) sees widths off the vector lanes. The expected graph is the map's own, or has
+// an edge taken out or put in, or the map has a cell recoloured or set to a
+// colour outside 1..N.
+static string validatorDifferential() {
+    mt19937 rng(3);
+    for (int i = 0; i < 3000; i++) {
+        int maxSide = i % 10 == 0 ? 240 : i % 3 == 0 ? 32 : 16;
+        int rows = genSize(rng, 1, maxSide), cols = genSize(rng, 1, maxSide);
+        int N = genSize(rng, 1, min(40, rows * cols));
+        Grid grid(rows, cols, 1);
+        if (rng() % 4 == 0) {
+            // A few stripes on colour 1, columns often in the last nine where
+            // the kernels' scalar tails run: every boundary of a stripe is
+            // the same pair of columns (or rows), so one missed pair shows.
+            N = genSize(rng, 1, min(4, max(rows, cols)));
+            for (int v = 2; v <= N; v++) {
+                if (rng() % 2) {
+                    int c = rng() % 2 ? (int)(rng() % cols) : max(0, cols - 1 - (int)(rng() % 9));
+                    for (int r = 0; r < rows; r++) grid.at(r, c) = v;
+                } else {
+                    int r = rng() % rows;
+                    for (int c = 0; c < cols; c++) grid.at(r, c) = v;
                 }
             }
+        } else {
+            Grid region = genRegionGrid(N, max(max(rows, cols), (int)ceil(sqrt(N))), rng);
+            for (int r = 0; r < rows; r++) {
+                for (int c = 0; c < cols; c++) grid.at(r, c) = region.at(r, c);
+            }
         }
+        EdgeMatrix expected;
+        expected.reset(N);
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < cols; c++) {
+                int v = grid.at(r, c);
+                if (c + 1 < cols && v != grid.at(r, c + 1)) expected.add(v, grid.at(r, c + 1));
+                if (r + 1 < rows && v != grid.at(r + 1, c)) expected.add(v, grid.at(r + 1, c));
+            }
+        }
+        int u = genSize(rng, 1, N), v = genSize(rng, 1, N);
+        int& cell = grid.at(rng() % rows, rng() % cols);
+        switch (rng() % 5) {
+        case 1:
+            expected.row[u] &= ~(1ULL << v);
+            expected.row[v] &= ~(1ULL << u);
+            break;
+        case 2:
+            if (u != v) expected.add(u, v);
+            break;
+        case 3:
+            cell = u;
+            break;
+        case 4: {
+            const int invalid[] = {0, -1, N + 1, 1 << 20};
+            cell = invalid[rng() % 4];
+            break;
+        }
+        }
+        MapCheck fast = checkMap(grid, expected), reference = referenceCheck(grid, expected);
+        if (!sameCheck(fast, reference))
+            return "case " + to_string(i) + " (" + to_string(rows) + "x" + to_string(cols) + ", N=" +
+                   to_string(N) + "): checkMap " + describe(fast) + ", reference " + describe(reference);
+    }
+    return "";
+}
 
-        // Check all grid adjacencies are in graph
-        for (auto [u, v] : gridAdj) {
-            if (adj[u].find(v) == adj[u].end()) {
-                cout << "ERROR: Grid adjacency (" << u << "," << v << ") not in graph\n";
-                return false;
+// Every row-scan kernel the CPU runs against rowScanScalar, at every width
+// up to 240 (so every tail length), with and without a next row, on rows
+// of few colours so equal and unequal neighbours both come up. Rows are
+// allocated at their exact width so a sanitizer build catches overreads,
+// and the masks start dirty because the kernels must clear them.
+static string rowScanKernels() {
+    struct Kernel {
+        const char* name;
+        RowScanFn scan;
+    };
+    vector<Kernel> kernels;
+#if WORLD_MAP_X86
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", rowScanAvx2});
+#elif WORLD_MAP_NEON
+    kernels.push_back({"neon", rowScanNeon});
+#endif
+    if (kernels.empty()) return "";
+    mt19937 rng(4);
+    for (int cols = 1; cols <= 240; cols++) {
+        for (int round = 0; round < 20; round++) {
+            vector<int> cur(cols), next(cols);
+            int colors = 1 + round % 4;
+            for (int j = 0; j < cols; j++) cur[j] = 1 + (int)(rng() % colors), next[j] = 1 + (int)(rng() % colors);
+            const int* below = round % 5 ? next.data() : nullptr;
+            uint64_t right[ROW_MASK_WORDS], down[ROW_MASK_WORDS];
+            rowScanScalar(cur.data(), below, cols, right, down);
+            for (const Kernel& k : kernels) {
+                uint64_t kRight[ROW_MASK_WORDS], kDown[ROW_MASK_WORDS];
+                for (int w = 0; w < ROW_MASK_WORDS; w++) kRight[w] = kDown[w] = rng() | 1;
+                k.scan(cur.data(), below, cols, kRight, kDown);
+                for (int w = 0; w < (cols + 63) / 64; w++) {
+                    if (kRight[w] != right[w] || kDown[w] != down[w])
+                        return string(k.name) + ": width " + to_string(cols) + " word " + to_string(w) + " differs";
+                }
             }
         }
+    }
+    return "";
+}
 
-        return true;
+// A random tree of one of three shapes: uniform (a random Pruefer code), a
+// caterpillar (a spine with leaves hung on it) or a spider (legs from one
+// centre), under a random labelling.
+static GraphCase randomTree(int N, mt19937& rng) {
+    GraphCase g;
+    g.N = N;
+    int shape = rng() % 3;
+    if (shape == 0) {
+        vector<int> code(max(N - 2, 0)), degree(N + 1, 1);
+        for (int& x : code) x = 1 + (int)(rng() % N), degree[x]++;
+        for (int x : code) {
+            int leaf = 1;
+            while (degree[leaf] != 1) leaf++;
+            g.add(leaf, x);
+            degree[leaf]--;
+            degree[x]--;
+        }
+        int u = 0;
+        for (int v = 1; v <= N; v++) {
+            if (degree[v] != 1) continue;
+            if (u) g.add(u, v);
+            else u = v;
+        }
+    } else if (shape == 1) {
+        int spine = genSize(rng, 1, N);
+        for (int v = 2; v <= spine; v++) g.add(v - 1, v);
+        for (int v = spine + 1; v <= N; v++) g.add(genSize(rng, 1, spine), v);
+    } else {
+        for (int v = 2; v <= N; v++) g.add(rng() % 3 ? v - 1 : 1, v);
     }
+    return relabelled(g, rng);
+}
 
-public:
-    bool test(int N, int M, vector<int> A, vector<int> B, string testName) {
-        this->N = N;
-        this->M = M;
-        adj.assign(N + 1, set<int>());
+// treeStripMap on every tree shape: a valid map, with K <= N.
+static string treeStripTrees() {
+    mt19937 rng(19);
+    for (int i = 0; i < 20000; i++) {
+        int N = genSize(rng, 3, 40);
+        GraphCase g = randomTree(N, rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        Grid grid = treeStripMap(graph, nullptr);
+        string at = "case " + to_string(i) + " (N=" + to_string(N) + ")";
+        if (grid.empty()) return at + ": no grid";
+        MapCheck check = checkMap(grid, graph);
+        if (!check.ok()) return at + ": invalid, " + describe(check);
+        if (grid.side() > N) return at + ": K=" + to_string(grid.side()) + " > N";
+    }
+    return "";
+}
 
-        for (int i = 0; i < M; i++) {
-            adj[A[i]].insert(B[i]);
-            adj[B[i]].insert(A[i]);
+// diagonalMap on random connected graphs of every density: a valid map with
+// K <= 2N, and K = N on trees.
+static string diagonalBound() {
+    mt19937 rng(9);
+    for (int i = 0; i < 20000; i++) {
+        int N = genSize(rng, 1, 40);
+        bool tree = i % 4 == 0;
+        GraphCase g = tree ? randomTree(N, rng) : genRandom(N, uniform_real_distribution<double>(0, 1)(rng), rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        Grid grid = diagonalMap(graph, nullptr);
+        string at = "case " + to_string(i) + " (N=" + to_string(N) + ", M=" + to_string(g.M) + ")";
+        if (grid.empty()) return at + ": no grid";
+        MapCheck check = checkMap(grid, graph);
+        if (!check.ok()) return at + ": invalid, " + describe(check);
+        if (grid.side() > 2 * N) return at + ": K=" + to_string(grid.side()) + " > 2N";
+        if (tree && grid.side() != N) return at + ": tree with K=" + to_string(grid.side()) + " != N";
+    }
+    return "";
+}
+
+// Grids are equal in shape and every cell.
+static bool sameGrid(const Grid& a, const Grid& b) {
+    if (a.rows() != b.rows() || a.cols() != b.cols()) return false;
+    for (int r = 0; r < a.rows(); r++) {
+        if (!equal(a.row(r), a.row(r) + a.cols(), b.row(r))) return false;
+    }
+    return true;
+}
+
+static Grid copyOf(const Grid& grid) {
+    Grid copied(grid.rows(), grid.cols());
+    for (int r = 0; r < grid.rows(); r++) copy(grid.row(r), grid.row(r) + grid.cols(), copied.row(r));
+    return copied;
+}
+
+// Random place() and clear() (of any placed cell, not only the last) on
+// `State` bound to a KxK grid, each step checked against a recount from
+// scratch of the grid: colour counts, realised edges, false adjacencies,
+// unrealised masks, completeness and each cell's touching and safe colours.
+template <class State>
+static string placementRecount(State& state, int minK, int maxK, mt19937& rng) {
+    for (int i = 0; i < 40; i++) {
+        int N = genSize(rng, 1, 20);
+        GraphCase g = genRandom(N, uniform_real_distribution<double>(0, 1)(rng), rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        int K = genSize(rng, minK, maxK);
+        Grid grid(K, K);
+        state.reset(graph, grid);
+        vector<int> placed;
+        for (int step = 0; step < 300; step++) {
+            if (!placed.empty() && (placed.size() == (size_t)K * K || rng() % 5 < 2)) {
+                size_t j = rng() % placed.size();
+                state.clear(placed[j]);
+                placed[j] = placed.back();
+                placed.pop_back();
+            } else {
+                int cell;
+                do cell = (int)(rng() % (K * K));
+                while (grid.data()[cell]);
+                state.place(cell, genSize(rng, 1, N));
+                placed.push_back(cell);
+            }
+
+            string at = "case " + to_string(i) + " step " + to_string(step) + " (N=" + to_string(N) + ", K=" +
+                        to_string(K) + ")";
+            int count[EdgeMatrix::MAX_NODES + 1] = {};
+            int realized[EdgeMatrix::MAX_NODES + 1][EdgeMatrix::MAX_NODES + 1] = {};
+            int falsePairs = 0;
+            uint64_t present = 0;
+            for (int r = 0; r < K; r++) {
+                for (int c = 0; c < K; c++) {
+                    int v = grid.at(r, c);
+                    if (state.color(r * K + c) != v) return at + ": colour differs from the grid";
+                    if (v) count[v]++, present |= 1ULL << v;
+                    if (!v) continue;
+                    int right = c + 1 < K ? grid.at(r, c + 1) : 0, down = r + 1 < K ? grid.at(r + 1, c) : 0;
+                    for (int w : {right, down}) {
+                        if (!w || w == v) continue;
+                        if (graph.has(v, w)) realized[min(v, w)][max(v, w)]++;
+                        else falsePairs++;
+                    }
+                }
+            }
+            int unrealized = 0;
+            for (int u = 1; u <= N; u++) {
+                if (state.colorCount(u) != count[u]) return at + ": colour count of " + to_string(u);
+                uint64_t mask = 0;
+                for (int v = 1; v <= N; v++) {
+                    if (v == u || !graph.has(u, v)) continue;
+                    bool done = realized[min(u, v)][max(u, v)] > 0;
+                    if (state.edgeRealized(u, v) != done) return at + ": edge " + to_string(u) + "-" + to_string(v);
+                    if (!done) mask |= 1ULL << v, unrealized += u < v;
+                }
+                if (state.unrealizedMask(u) != mask) return at + ": unrealised mask of " + to_string(u);
+            }
+            if (state.presentColors() != present) return at + ": present colours";
+            if (state.unrealizedEdges() != unrealized) return at + ": unrealised edge count";
+            if (state.falseAdjacencies() != falsePairs) return at + ": false adjacency count";
+            if (state.complete() != (!unrealized && !falsePairs && present == state.allColors()))
+                return at + ": completeness";
+            for (int r = 0; r < K; r++) {
+                for (int c = 0; c < K; c++) {
+                    uint64_t touching = 0;
+                    if (r > 0) touching |= 1ULL << grid.at(r - 1, c);
+                    if (r + 1 < K) touching |= 1ULL << grid.at(r + 1, c);
+                    if (c > 0) touching |= 1ULL << grid.at(r, c - 1);
+                    if (c + 1 < K) touching |= 1ULL << grid.at(r, c + 1);
+                    touching &= ~1ULL;
+                    uint64_t safe = state.allColors();
+                    for (uint64_t t = touching; t; t &= t - 1) {
+                        int w = __builtin_ctzll(t);
+                        safe &= graph.row[w] | (1ULL << w);
+                    }
+                    int cell = r * K + c;
+                    if (state.touching(cell) != touching || state.safeColors(cell) != safe)
+                        return at + ": touching colours of cell " + to_string(cell);
+                }
+            }
         }
+    }
+    return "";
+}
 
-        cout << "\n=== Test: " << testName << " ===\n";
-        cout << "N=" << N << ", M=" << M << "\n";
+// The recount on PlacementState and on each FixedPlacementState kernel.
+static string placementCounters() {
+    mt19937 rng(5);
+    string why;
+    PlacementState generic;
+    static FixedPlacementState<16> fixed16;
+    static FixedPlacementState<32> fixed32;
+    static FixedPlacementState<64> fixed64;
+    if ((why = placementRecount(generic, 1, 24, rng)).size()) return "PlacementState " + why;
+    if ((why = placementRecount(fixed16, 1, 16, rng)).size()) return "FixedPlacementState<16> " + why;
+    if ((why = placementRecount(fixed32, 17, 32, rng)).size()) return "FixedPlacementState<32> " + why;
+    if ((why = placementRecount(fixed64, 33, 64, rng)).size()) return "FixedPlacementState<64> " + why;
+    return "";
+}
 
-        grid = create_map(N, M, A, B);
-        printGrid();
+// MapSearch on sides picked so each of its kernels (FixedPlacementState 16,
+// 32, 64 and PlacementState beyond) runs, against BasicMapSearch on the
+// generic PlacementState: the same outcome, node count and map, any map
+// found valid, and the node budget kept. Then searchSmallestMap, whose map
+// must be valid and no larger than maxK, and of the side the generic
+// kernel first finds one at under the same per-side budget. Budgets are in
+// nodes only, so the runs are deterministic.
+static string searchKernels() {
+    mt19937 rng(6);
+    SearchBudget budget;
+    budget.maxSeconds = 1e9;
+    budget.maxNodes = 20000;
+    MapSearch dispatch;
+    BasicMapSearch<PlacementState> generic;
+    const int sides[4][2] = {{1, 16}, {17, 32}, {33, 64}, {65, 72}};
+    int found[4] = {};
+    for (int i = 0; i < 400; i++) {
+        int N = genSize(rng, 1, 8);
+        GraphCase g = genRandom(N, 0.4, rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        int K = genSize(rng, max(sides[i % 4][0], (int)ceil(sqrt(N))), sides[i % 4][1]);
+        Grid a(K, K), b(K, K);
+        bool foundA = dispatch.run(graph, a, budget), foundB = generic.run(graph, b, budget);
+        string at = "case " + to_string(i) + " (N=" + to_string(N) + ", K=" + to_string(K) + ")";
+        if (foundA != foundB || dispatch.nodesVisited() != generic.nodesVisited() ||
+            dispatch.exhausted() != generic.exhausted())
+            return at + ": kernel and generic search disagree";
+        if (dispatch.nodesVisited() > budget.maxNodes) return at + ": node budget exceeded";
+        if (!foundA) continue;
+        found[i % 4]++;
+        if (!sameGrid(a, b)) return at + ": kernel and generic maps differ";
+        MapCheck check = checkMap(a, graph);
+        if (!check.ok()) return at + ": search map invalid, " + describe(check);
+    }
+    for (int k = 0; k < 4; k++) {
+        if (!found[k]) return "no map found on sides " + to_string(sides[k][0]) + ".." + to_string(sides[k][1]);
+    }
 
-        bool valid = validate();
-        if (valid) {
-            cout << "PASS - K/N ratio: " << (double)grid.size() / N << "\n";
-        } else {
-            cout << "FAIL\n";
+    for (int i = 0; i < 200; i++) {
+        int N = genSize(rng, 1, 8);
+        GraphCase g = genRandom(N, 0.4, rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        const int maxK = 12;
+        Grid grid = searchSmallestMap(graph, maxK, budget);
+        int lo = max(1, (int)ceil(sqrt(N)));
+        SearchBudget slice = budget;
+        slice.maxNodes = max(1LL, budget.maxNodes / (maxK - lo + 1));
+        int expectedSide = 0;
+        for (int K = lo; K <= maxK && !expectedSide; K++) {
+            Grid attempt(K, K);
+            if (generic.run(graph, attempt, slice)) expectedSide = K;
         }
+        string at = "smallest case " + to_string(i) + " (N=" + to_string(N) + ")";
+        if (grid.side() != expectedSide)
+            return at + ": side " + to_string(grid.side()) + ", generic " + to_string(expectedSide);
+        if (grid.empty()) continue;
+        MapCheck check = checkMap(grid, graph);
+        if (!check.ok()) return at + ": invalid, " + describe(check);
+    }
+    return "";
+}
 
-        return valid;
+// SideOptimizer::minimize from a valid map: the result is valid, no larger
+// than the input and no smaller than sideLowerBound, and the report says
+// so. With the budget already spent (no nodes, or no time) the input comes
+// back cell for cell. Budgets are in nodes only, so the runs are
+// deterministic.
+static string sideOptimizer() {
+    mt19937 rng(8);
+    SearchBudget budget;
+    budget.maxSeconds = 1e9;
+    budget.maxNodes = 20000;
+    SideOptimizer optimizer;
+    int shrunk = 0;
+    for (int i = 0; i < 300; i++) {
+        int N = genSize(rng, 1, 12);
+        GraphCase g = genRandom(N, uniform_real_distribution<double>(0, 0.6)(rng), rng);
+        EdgeMatrix graph = EdgeMatrix::fromEdges(g.N, g.M, g.A, g.B);
+        Grid known = i % 2 ? diagonalMap(graph, nullptr) : quickMap(graph);
+        string at = "case " + to_string(i) + " (N=" + to_string(N) + ")";
+        if (!checkMap(known, graph).ok()) return at + ": input map invalid";
+        Grid input = copyOf(known);
+
+        SideReport report;
+        Grid grid = optimizer.minimize(graph, std::move(known), budget, nullptr, &report);
+        MapCheck check = checkMap(grid, graph);
+        if (!check.ok()) return at + ": invalid, " + describe(check);
+        if (grid.side() > input.side())
+            return at + ": K=" + to_string(grid.side()) + " > input " + to_string(input.side());
+        if (grid.side() < sideLowerBound(graph))
+            return at + ": K=" + to_string(grid.side()) + " below the lower bound";
+        if (report.side != grid.side() || report.lowerBound != sideLowerBound(graph) ||
+            (report.attempts == 0) != (input.side() <= sideLowerBound(graph)))
+            return at + ": report disagrees with the map";
+        shrunk += grid.side() < input.side();
+
+        for (int spent = 0; spent < 2; spent++) {
+            SearchBudget none = budget;
+            if (spent) none.maxSeconds = 0;
+            else none.maxNodes = 0;
+            Grid same = optimizer.minimize(graph, copyOf(input), none, nullptr, &report);
+            if (!sameGrid(same, input) || report.attempts != 0)
+                return at + ": spent budget (" + (spent ? "time" : "nodes") + ") changed the map";
+        }
     }
-};
+    if (!shrunk) return "no map was ever shrunk";
+    return "";
+}
 
-int main() {
-    Validator validator;
+// A batch built on a pool matches the serial build map for map and cell for
+// cell, including when the pooled MapBatch is reused. The budget is nodes
+// only, so the results cannot depend on how the pool schedules graphs.
+static string pooledBatch() {
+    mt19937 rng(12);
+    vector<GraphFamily> families = graphFamilies();
+    GraphBatch batch;
+    for (int i = 0; i < 120; i++) {
+        GraphCase g = families[i % families.size()].make(rng);
+        batch.add(g.N, g.M, g.A, g.B);
+    }
+    MapOptions options;
+    options.budget.maxSeconds = 1e9;
+    options.budget.maxNodes = 20000;
+    MapBatch serial, pooled;
+    build_maps(batch, serial, options);
+    ThreadPool pool(4);
+    for (int round = 0; round < 2; round++) {
+        build_maps(batch, pooled, options, &pool);
+        string at = "round " + to_string(round);
+        if (pooled.size() != serial.size())
+            return at + ": " + to_string(pooled.size()) + " maps, serial " + to_string(serial.size());
+        for (int g = 0; g < serial.size(); g++) {
+            if (pooled.rows[g] != serial.rows[g] || pooled.cols[g] != serial.cols[g])
+                return at + " map " + to_string(g) + ": shape differs";
+            const int* a = serial.cells.data() + serial.offset[g];
+            const int* b = pooled.cells.data() + pooled.offset[g];
+            if (!equal(a, a + (size_t)serial.rows[g] * serial.cols[g], b))
+                return at + " map " + to_string(g) + ": cells differ";
+        }
+    }
+    return "";
+}
+
+// The grader's path: create_maps (graderOptions and the process-wide cache)
+// over family graphs, one of them repeated as is and relabelled. Every map
+// must pass checkMap. Served by the cache, the repeat must get the first
+// map again, each relabelled copy the original's map under a relabelling,
+// and a second pass over the batch the maps of the first.
+static string graderBatch() {
+    mt19937 rng(18);
+    vector<GraphFamily> families = graphFamilies();
+    vector<GraphCase> graphs;
+    for (int i = 0; i < 60; i++) graphs.push_back(families[i % families.size()].make(rng));
+    graphs.push_back(graphs[7]);
+    for (int i = 0; i < 5; i++) graphs.push_back(relabelled(graphs[i], rng));
+    GraphBatch batch;
+    for (const GraphCase& g : graphs) batch.add(g.N, g.M, g.A, g.B);
+
+    MapBatch first, second;
+    create_maps(batch, first);
+    if (first.size() != batch.size())
+        return to_string(first.size()) + " maps for " + to_string(batch.size()) + " graphs";
+    for (int g = 0; g < first.size(); g++) {
+        const GraphCase& graph = graphs[g];
+        MapCheck check = checkMap(Grid::fromVectors(first.toVectors(g)),
+                                  EdgeMatrix::fromEdges(graph.N, graph.M, graph.A, graph.B));
+        if (!check.ok()) return "map " + to_string(g) + " invalid, " + describe(check);
+    }
+    if (first.toVectors(60) != first.toVectors(7)) return "repeated graph got a different map";
+    for (int i = 0; i < 5; i++) {
+        vector<vector<int>> a = first.toVectors(i), b = first.toVectors(61 + i);
+        bool same = a.size() == b.size() && a[0].size() == b[0].size();
+        vector<int> to(EdgeMatrix::MAX_NODES + 1, 0), from(EdgeMatrix::MAX_NODES + 1, 0);
+        for (size_t r = 0; same && r < a.size(); r++) {
+            for (size_t c = 0; same && c < a[r].size(); c++) {
+                int u = a[r][c], v = b[r][c];
+                if (!to[u] && !from[v]) to[u] = v, from[v] = u;
+                same = to[u] == v && from[v] == u;
+            }
+        }
+        if (!same) return "relabelled copy of graph " + to_string(i) + " did not get its cached map";
+    }
+    create_maps(batch, second);
+    for (int g = 0; g < first.size(); g++) {
+        if (second.toVectors(g) != first.toVectors(g)) return "map " + to_string(g) + " changed on the cached pass";
+    }
+    return "";
+}
+
+// Usage: world_map_test [--quiet] [--dump]
+// Build: g++ -std=c++20 -O2 world_map_test.cpp world_map.cpp -lpthread
+int main(int argc, char** argv) {
+    OutputMode mode = OutputMode::Verbose;
+    bool dumpAll = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--quiet") mode = OutputMode::Quiet;
+        else if (arg == "--dump") dumpAll = true;
+        else {
+            cerr << "usage: " << argv[0] << " [--quiet] [--dump]\n";
+            return 2;
+        }
+    }
+    BufferedWriter out;
+    Validator validator(out, mode, dumpAll);
     int passed = 0, total = 0;
 
     // Test 1: Single node
@@ -177,9 +836,40 @@ int main() {
     total++;
     if (validator.test(10, 9, {1,1,1,1,1,1,1,1,1}, {2,3,4,5,6,7,8,9,10}, "Star graph (10 nodes)")) passed++;
 
-    cout << "\n=================================\n";
-    cout << "Results: " << passed << "/" << total << " tests passed\n";
-    cout << "=================================\n";
+    struct Property {
+        const char* name;
+        string (*run)();
+    };
+    const Property properties[] = {
+        {"Validator matches the reference", validatorDifferential},
+        {"Row-scan kernels match scalar", rowScanKernels},
+        {"Codec round trip", codecRoundTrip},
+        {"Cache hit on relabelled graphs", cacheRelabelled},
+        {"Cache save/load round trip", cacheSaveLoad},
+        {"Pooled batch matches serial", pooledBatch},
+        {"Grader batch is valid and cached", graderBatch},
+        {"Tree strip is valid with K <= N", treeStripTrees},
+        {"Diagonal map is valid with K <= 2N", diagonalBound},
+        {"Placement counters match a recount", placementCounters},
+        {"Search kernels agree and stay in budget", searchKernels},
+        {"Side optimizer shrinks within bounds", sideOptimizer},
+    };
+    for (const Property& p : properties) {
+        total++;
+        string why = p.run();
+        if (why.empty()) passed++;
+        out << (mode == OutputMode::Quiet ? "" : "\n") << (why.empty() ? "PASS " : "FAIL ") << p.name;
+        out << (why.empty() ? "" : " - ") << why << '\n';
+    }
+
+    if (mode == OutputMode::Quiet) {
+        out << "Results: " << passed << "/" << total << " tests passed\n";
+    } else {
+        out << "\n=================================\n";
+        out << "Results: " << passed << "/" << total << " tests passed\n";
+        out << "=================================\n";
+    }
+    out.flush();
 
     return (passed == total) ? 0 : 1;
 }
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "world_map_grid.h"
+#include "world_map_simd.h"
+
+// Symmetric adjacency bit matrix over colours 1..n: bit v of row[u] is set
+// iff u and v are adjacent. N <= 40, so each row is a single word.
+struct EdgeMatrix {
+    static const int MAX_NODES = 40;
+
+    int n = 0;
+    uint64_t row[MAX_NODES + 1] = {};
+
+    void reset(int nodes) {
+        n = nodes;
+        for (uint64_t& r : row) r = 0;
+    }
+
+    void add(int u, int v) {
+        row[u] |= 1ULL << v;
+        row[v] |= 1ULL << u;
+    }
+
+    bool has(int u, int v) const { return (row[u] >> v) & 1; }
+
+    static EdgeMatrix fromEdges(int N, int M, std::span<const int> A, std::span<const int> B) {
+        EdgeMatrix m;
+        m.reset(N);
+        for (int i = 0; i < M; i++) m.add(A[i], B[i]);
+        return m;
+    }
+
+    // `pairs` holds M edges as consecutive (u, v) values.
+    static EdgeMatrix fromPairs(int N, int M, const int* pairs) {
+        EdgeMatrix m;
+        m.reset(N);
+        for (int i = 0; i < M; i++) m.add(pairs[2 * i], pairs[2 * i + 1]);
+        return m;
+    }
+};
+
+enum class MapError {
+    None,
+    Empty,
+    TooLarge,
+    InvalidColor,
+    MissingColor,
+    MissingEdge,
+    FalseAdjacency,
+};
+
+// Outcome of checkMap(). Diagnostic fields are only filled on failure:
+// (u, v) is the offending pair, (r, c) the offending cell, `present` the
+// number of distinct colours seen.
+struct MapCheck {
+    MapError error = MapError::None;
+    int u = 0, v = 0;
+    int r = 0, c = 0;
+    int present = 0;
+
+    bool ok() const { return error == MapError::None; }
+};
+
+// Single pass over the grid in row pairs: the row-scan kernel marks colour
+// boundaries against the right and down neighbours and only those pairs are
+// ORed into `observed`. Returns false (with the cell in r/c) on a colour
+// outside 1..n, and records the set of colours seen in `present`.
+inline bool collectAdjacency(const Grid& grid, int n, EdgeMatrix& observed, uint64_t& present,
+                             int& badR, int& badC) {
+    observed.reset(n);
+    present = 0;
+    int rows = grid.rows();
+    int cols = grid.cols();
+    RowScanFn scan = rowScan();
+    uint64_t right[ROW_MASK_WORDS], down[ROW_MASK_WORDS];
+    auto colorsValid = [&](int i) {
+        const int* row = grid.row(i);
+        for (int j = 0; j < cols; j++) {
+            if ((unsigned)(row[j] - 1) >= (unsigned)n) {
+                badR = i;
+                badC = j;
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!colorsValid(0)) return false;
+    for (int i = 0; i < rows; i++) {
+        const int* cur = grid.row(i);
+        const int* next = (i + 1 < rows) ? grid.row(i + 1) : nullptr;
+        // The scan pairs cur with next, so next is checked before it.
+        if (next && !colorsValid(i + 1)) return false;
+        for (int j = 0; j < cols; j++) present |= 1ULL << cur[j];
+
+        scan(cur, next, cols, right, down);
+        for (int w = 0; w < (cols + 63) / 64; w++) {
+            for (uint64_t m = right[w]; m; m &= m - 1) {
+                int j = (w << 6) + __builtin_ctzll(m);
+                observed.add(cur[j], cur[j + 1]);
+            }
+            for (uint64_t m = down[w]; m; m &= m - 1) {
+                int j = (w << 6) + __builtin_ctzll(m);
+                observed.add(cur[j], next[j]);
+            }
+        }
+    }
+    return true;
+}
+
+// Second half of every map check: compares the colours and adjacency seen
+// on a map with the expected graph. The first missing edge / first false
+// adjacency (in (u, v) order, u < v) are only searched for once the
+// word-wide comparison fails. Clears the diagonal of `observed`.
+inline MapCheck compareAdjacency(EdgeMatrix& observed, uint64_t present, const EdgeMatrix& expected) {
+    MapCheck result;
+    int n = expected.n;
+    result.present = __builtin_popcountll(present);
+    if (result.present != n) {
+        result.error = MapError::MissingColor;
+        return result;
+    }
+
+    uint64_t diff = 0;
+    for (int u = 1; u <= n; u++) {
+        observed.row[u] &= ~(1ULL << u);
+        diff |= observed.row[u] ^ expected.row[u];
+    }
+    if (!diff) return result;
+
+    // Failure path: locate the first offending pair for the diagnostics.
+    for (int u = 1; u <= n; u++) {
+        uint64_t missing = expected.row[u] & ~observed.row[u] & (~0ULL << (u + 1));
+        if (missing) {
+            result.error = MapError::MissingEdge;
+            result.u = u;
+            result.v = __builtin_ctzll(missing);
+            return result;
+        }
+    }
+    for (int u = 1; u <= n; u++) {
+        uint64_t extra = observed.row[u] & ~expected.row[u] & (~0ULL << (u + 1));
+        if (extra) {
+            result.error = MapError::FalseAdjacency;
+            result.u = u;
+            result.v = __builtin_ctzll(extra);
+            return result;
+        }
+    }
+    return result;
+}
+
+// Validator specialised on a compile-time bound of both grid dimensions.
+// Cells are copied into a stack array with a sentinel (colour 0) column on
+// the right and row below, then every cell ORs its right and down
+// neighbours into its row of `observed` unconditionally. Sentinel pairs land
+// in bit 0 and equal colours on the diagonal; both are dropped before
+// comparing.
+template <int MaxSide>
+MapCheck checkMapFixed(const Grid& grid, const EdgeMatrix& expected) {
+    const int STRIDE = MaxSide + 1;
+    MapCheck result;
+    int n = expected.n;
+    int rows = grid.rows(), cols = grid.cols();
+    std::array<uint8_t, STRIDE * (MaxSide + 1)> cells{};
+
+    uint64_t present = 0;
+    for (int r = 0; r < rows; r++) {
+        const int* row = grid.row(r);
+        unsigned bad = 0;
+        for (int c = 0; c < cols; c++) bad |= (unsigned)(row[c] - 1) >= (unsigned)n;
+        if (bad) {
+            int c = 0;
+            while ((unsigned)(row[c] - 1) < (unsigned)n) c++;
+            result.error = MapError::InvalidColor;
+            result.u = row[c];
+            result.r = r;
+            result.c = c;
+            return result;
+        }
+        uint8_t* out = cells.data() + r * STRIDE;
+        for (int c = 0; c < cols; c++) {
+            out[c] = (uint8_t)row[c];
+            present |= 1ULL << row[c];
+        }
+    }
+
+    EdgeMatrix observed;
+    observed.reset(n);
+    for (int r = 0; r < rows; r++) {
+        const uint8_t* cur = cells.data() + r * STRIDE;
+        for (int c = 0; c < cols; c++) {
+            observed.row[cur[c]] |= (1ULL << cur[c + 1]) | (1ULL << cur[c + STRIDE]);
+        }
+    }
+    // Symmetrise: O(pairs) once instead of two more updates per cell.
+    for (int u = 1; u <= n; u++) {
+        for (uint64_t m = observed.row[u] & ~1ULL; m; m &= m - 1) observed.row[__builtin_ctzll(m)] |= 1ULL << u;
+    }
+    for (int u = 1; u <= n; u++) observed.row[u] &= ~1ULL;
+    return compareAdjacency(observed, present, expected);
+}
+
+// Validates `grid` against the expected adjacency in O(K^2 + N) with no
+// allocation. Sides up to 32 go to the smallest checkMapFixed that fits;
+// beyond that the vectorised row scan is at least as fast.
+inline MapCheck checkMap(const Grid& grid, const EdgeMatrix& expected) {
+    MapCheck result;
+    int n = expected.n;
+    if (grid.empty()) {
+        result.error = MapError::Empty;
+        return result;
+    }
+    if (grid.side() > 240) {
+        result.error = MapError::TooLarge;
+        return result;
+    }
+
+    int side = grid.side();
+    if (side <= 16) return checkMapFixed<16>(grid, expected);
+    if (side <= 32) return checkMapFixed<32>(grid, expected);
+
+    EdgeMatrix observed;
+    uint64_t present = 0;
+    if (!collectAdjacency(grid, n, observed, present, result.r, result.c)) {
+        result.error = MapError::InvalidColor;
+        result.u = grid.at(result.r, result.c);
+        return result;
+    }
+
+    return compareAdjacency(observed, present, expected);
+}